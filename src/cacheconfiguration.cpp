@@ -38,10 +38,12 @@ CacheConfiguration::CacheConfiguration()
     : m_displayLabelOrder(FirstNameFirst)
     , m_sortProperty(QString::fromLatin1("firstName"))
     , m_groupProperty(QString::fromLatin1("firstName"))
+    , m_updateFrameBudget(4)
 #ifdef HAS_MLITE
     , m_displayLabelOrderConf(QLatin1String("/org/nemomobile/contacts/display_label_order"))
     , m_sortPropertyConf(QLatin1String("/org/nemomobile/contacts/sort_property"))
     , m_groupPropertyConf(QLatin1String("/org/nemomobile/contacts/group_property"))
+    , m_updateFrameBudgetConf(QLatin1String("/org/nemomobile/contacts/update_frame_budget"))
 #endif
 {
 #ifdef HAS_MLITE
@@ -59,6 +61,9 @@ CacheConfiguration::CacheConfiguration()
     QVariant groupPropertyConf = m_groupPropertyConf.value();
     if (groupPropertyConf.isValid())
         m_groupProperty = groupPropertyConf.toString();
+
+    connect(&m_updateFrameBudgetConf, SIGNAL(valueChanged()), this, SLOT(onUpdateFrameBudgetChanged()));
+    onUpdateFrameBudgetChanged();
 #endif
 }
 
@@ -103,5 +108,21 @@ void CacheConfiguration::onGroupPropertyChanged()
         emit groupPropertyChanged(m_groupProperty);
     }
 }
+
+void CacheConfiguration::onUpdateFrameBudgetChanged()
+{
+    QVariant updateFrameBudget = m_updateFrameBudgetConf.value();
+    if (updateFrameBudget.isValid()) {
+        bool ok = false;
+        const int budget = updateFrameBudget.toInt(&ok);
+        if (!ok || budget < 0) {
+            qWarning() << "Invalid update frame budget configuration:" << updateFrameBudget;
+            return;
+        }
+
+        // The budget is read on each update, so no notification is required
+        m_updateFrameBudget = budget;
+    }
+}
 #endif
 
@@ -57,6 +57,7 @@ public:
     DisplayLabelOrder displayLabelOrder() const { return m_displayLabelOrder; }
     QString sortProperty() const { return m_sortProperty; }
     QString groupProperty() const { return m_groupProperty; }
+    int updateFrameBudget() const { return m_updateFrameBudget; }
 
 signals:
     void displayLabelOrderChanged(CacheConfiguration::DisplayLabelOrder order);
@@ -67,16 +68,19 @@ private:
     DisplayLabelOrder m_displayLabelOrder;
     QString m_sortProperty;
     QString m_groupProperty;
+    int m_updateFrameBudget;
 
 #ifdef HAS_MLITE
     MGConfItem m_displayLabelOrderConf;
     MGConfItem m_sortPropertyConf;
     MGConfItem m_groupPropertyConf;
+    MGConfItem m_updateFrameBudgetConf;
 
 private slots:
     void onDisplayLabelOrderChanged();
     void onSortPropertyChanged();
     void onGroupPropertyChanged();
+    void onUpdateFrameBudgetChanged();
 #endif
 };
 
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#ifndef CACHEITEMSTORE_H
+#define CACHEITEMSTORE_H
+
+#include <QVector>
+
+#include <new>
+#include <type_traits>
+
+// Storage for cache items keyed by internal contact ID.
+// Items are allocated in fixed-size slabs which are never moved or reallocated, so a pointer
+// to an item remains valid until that item is removed.  Items are located through a dense
+// open-addressed index, and iteration visits the slabs in order.
+
+template <typename T>
+class CacheItemStore
+{
+    enum { SlabSize = 256 };
+
+    struct Slot
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        quint32 key;
+        bool used;
+
+        T *item() { return reinterpret_cast<T *>(&storage); }
+        const T *item() const { return reinterpret_cast<const T *>(&storage); }
+    };
+
+    template <typename Store, typename Value>
+    class Iterator
+    {
+    public:
+        Iterator(Store *store, int slot) : m_store(store), m_slot(slot) { advance(); }
+
+        quint32 key() const { return m_store->slot(m_slot).key; }
+        Value &value() const { return *m_store->slot(m_slot).item(); }
+        Value &operator*() const { return value(); }
+        Value *operator->() const { return &value(); }
+
+        Iterator &operator++() { ++m_slot; advance(); return *this; }
+
+        bool operator==(const Iterator &other) const { return m_slot == other.m_slot; }
+        bool operator!=(const Iterator &other) const { return m_slot != other.m_slot; }
+
+    private:
+        void advance()
+        {
+            const int end = m_store->m_slabs.count() * SlabSize;
+            while (m_slot < end && !m_store->slot(m_slot).used)
+                ++m_slot;
+        }
+
+        Store *m_store;
+        int m_slot;
+    };
+
+public:
+    typedef Iterator<CacheItemStore, T> iterator;
+    typedef Iterator<const CacheItemStore, const T> const_iterator;
+
+    CacheItemStore() : m_count(0), m_indexMask(0) {}
+    ~CacheItemStore() { clear(); }
+
+    int count() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, m_slabs.count() * SlabSize); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_slabs.count() * SlabSize); }
+    const_iterator constBegin() const { return begin(); }
+    const_iterator constEnd() const { return end(); }
+
+    bool contains(quint32 key) const { return indexPosition(key) != -1; }
+
+    // Returns the item with this key, or null if there is no such item
+    T *find(quint32 key)
+    {
+        const int position = indexPosition(key);
+        return position != -1 ? slot(m_indexSlots.at(position)).item() : 0;
+    }
+
+    const T *find(quint32 key) const
+    {
+        const int position = indexPosition(key);
+        return position != -1 ? slot(m_indexSlots.at(position)).item() : 0;
+    }
+
+    // Returns the item with this key, inserting a default-constructed item if necessary
+    T &operator[](quint32 key)
+    {
+        if (T *item = find(key))
+            return *item;
+
+        if ((m_count + 1) * 4 > m_indexKeys.count() * 3) {
+            // Keep the index at most three-quarters full
+            rehash(qMax(m_indexKeys.count() * 2, 64));
+        }
+
+        const int slotIndex = allocateSlot();
+        Slot &s(slot(slotIndex));
+        new (&s.storage) T();
+        s.key = key;
+        s.used = true;
+
+        int position = hash(key) & m_indexMask;
+        while (m_indexSlots.at(position) != -1)
+            position = (position + 1) & m_indexMask;
+        m_indexKeys[position] = key;
+        m_indexSlots[position] = slotIndex;
+
+        ++m_count;
+        return *s.item();
+    }
+
+    bool remove(quint32 key)
+    {
+        int position = indexPosition(key);
+        if (position == -1)
+            return false;
+
+        const int slotIndex = m_indexSlots.at(position);
+        Slot &s(slot(slotIndex));
+        s.item()->~T();
+        s.used = false;
+        m_freeSlots.append(slotIndex);
+        --m_count;
+
+        // Shift any following entries of the probe sequence back into the vacated position,
+        // so that lookups never need to skip deleted entries
+        int next = (position + 1) & m_indexMask;
+        while (m_indexSlots.at(next) != -1) {
+            const int ideal = hash(m_indexKeys.at(next)) & m_indexMask;
+            if (((next - ideal) & m_indexMask) >= ((next - position) & m_indexMask)) {
+                m_indexKeys[position] = m_indexKeys.at(next);
+                m_indexSlots[position] = m_indexSlots.at(next);
+                position = next;
+            }
+            next = (next + 1) & m_indexMask;
+        }
+        m_indexSlots[position] = -1;
+        return true;
+    }
+
+    void clear()
+    {
+        for (int i = 0; i < m_slabs.count(); ++i) {
+            Slot *slab = m_slabs.at(i);
+            for (int j = 0; j < SlabSize; ++j) {
+                if (slab[j].used)
+                    slab[j].item()->~T();
+            }
+            delete [] slab;
+        }
+        m_slabs.clear();
+        m_freeSlots.clear();
+        m_indexKeys.clear();
+        m_indexSlots.clear();
+        m_indexMask = 0;
+        m_count = 0;
+    }
+
+private:
+    Q_DISABLE_COPY(CacheItemStore)
+
+    static quint32 hash(quint32 key)
+    {
+        // Fibonacci hashing spreads sequential IDs across the index
+        const quint32 h = key * 2654435769u;
+        return h ^ (h >> 16);
+    }
+
+    Slot &slot(int index) { return m_slabs.at(index / SlabSize)[index % SlabSize]; }
+    const Slot &slot(int index) const { return m_slabs.at(index / SlabSize)[index % SlabSize]; }
+
+    int indexPosition(quint32 key) const
+    {
+        if (m_count == 0)
+            return -1;
+
+        int position = hash(key) & m_indexMask;
+        while (m_indexSlots.at(position) != -1) {
+            if (m_indexKeys.at(position) == key)
+                return position;
+            position = (position + 1) & m_indexMask;
+        }
+        return -1;
+    }
+
+    int allocateSlot()
+    {
+        if (m_freeSlots.isEmpty()) {
+            Slot *slab = new Slot[SlabSize];
+            for (int i = 0; i < SlabSize; ++i)
+                slab[i].used = false;
+
+            // Use the slots of the new slab in ascending order
+            const int base = m_slabs.count() * SlabSize;
+            m_slabs.append(slab);
+            m_freeSlots.reserve(SlabSize);
+            for (int i = SlabSize - 1; i >= 0; --i)
+                m_freeSlots.append(base + i);
+        }
+
+        const int index = m_freeSlots.last();
+        m_freeSlots.removeLast();
+        return index;
+    }
+
+    void rehash(int capacity)
+    {
+        const QVector<quint32> keys(m_indexKeys);
+        const QVector<int> slots(m_indexSlots);
+
+        m_indexKeys = QVector<quint32>(capacity, 0);
+        m_indexSlots = QVector<int>(capacity, -1);
+        m_indexMask = capacity - 1;
+
+        for (int i = 0; i < slots.count(); ++i) {
+            if (slots.at(i) == -1)
+                continue;
+
+            int position = hash(keys.at(i)) & m_indexMask;
+            while (m_indexSlots.at(position) != -1)
+                position = (position + 1) & m_indexMask;
+            m_indexKeys[position] = keys.at(i);
+            m_indexSlots[position] = slots.at(i);
+        }
+    }
+
+    QVector<Slot *> m_slabs;
+    QVector<int> m_freeSlots;
+    QVector<quint32> m_indexKeys;
+    QVector<int> m_indexSlots;
+    int m_count;
+    int m_indexMask;
+};
+
+#endif
@@ -43,9 +43,12 @@
 #include <QCoreApplication>
 #include <QStandardPaths>
 #include <QDBusConnection>
+#include <QDataStream>
 #include <QDir>
 #include <QEvent>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
 
 #include <QContactAvatar>
 #include <QContactDetailFilter>
@@ -61,6 +64,7 @@
 #include <QContactGlobalPresence>
 #include <QContactSyncTarget>
 #include <QContactTimestamp>
+#include <QContactUnionFilter>
 
 #include <QVersitContactExporter>
 #include <QVersitContactImporter>
@@ -73,7 +77,8 @@
 
 #include <mce/dbus-names.h>
 #include <mce/mode-names.h>
-#include <phonenumbers/phonenumberutil.h>
+
+#include <algorithm>
 
 QTVERSIT_USE_NAMESPACE
 
@@ -339,11 +344,10 @@ QContactFilter aggregateFilter()
 
 typedef QPair<QString, QString> StringPair;
 
-QList<StringPair> addressPairs(const QContactPhoneNumber &phoneNumber)
+QList<StringPair> addressPairs(const QString &normalized)
 {
     QList<StringPair> rv;
 
-    const QString normalized(SeasideCache::normalizePhoneNumber(phoneNumber.number()));
     if (!normalized.isEmpty()) {
         const QChar plus(QChar::fromLatin1('+'));
         if (normalized.startsWith(plus)) {
@@ -401,95 +405,236 @@ QList<quint32> internalIds(const QList<QContactId> &ids)
     return rv;
 }
 
-QString::const_iterator firstDtmfChar(QString::const_iterator it, QString::const_iterator end)
+const quint32 snapshotMagic = 0x53435348; // 'SCSH'
+const quint32 snapshotVersion = 3;
+
+// The subset of a cache item required to present it before it has been queried
+struct SnapshotItem
 {
-    static const QString dtmfChars(QString::fromLatin1("pPwWxX#*"));
+    SnapshotItem() : iid(0), statusFlags(0) {}
 
-    for ( ; it != end; ++it) {
-        if (dtmfChars.contains(*it))
-            return it;
-    }
-    return end;
+    quint32 iid;
+    quint64 statusFlags;
+    QString displayLabel;
+    QString alternateDisplayLabel;
+    QString displayLabelGroup;
+    QString firstName;
+    QString lastName;
+    QStringList phoneNumbers;
+    QStringList emailAddresses;
+    QStringList accountPaths;
+    QStringList accountUris;
+};
+
+QDataStream &operator<<(QDataStream &stream, const SnapshotItem &item)
+{
+    return stream << item.iid << item.statusFlags << item.displayLabel << item.alternateDisplayLabel << item.displayLabelGroup
+                  << item.firstName << item.lastName << item.phoneNumbers << item.emailAddresses
+                  << item.accountPaths << item.accountUris;
 }
 
-const int ExactMatch = 100;
+QDataStream &operator>>(QDataStream &stream, SnapshotItem &item)
+{
+    return stream >> item.iid >> item.statusFlags >> item.displayLabel >> item.alternateDisplayLabel >> item.displayLabelGroup
+                  >> item.firstName >> item.lastName >> item.phoneNumbers >> item.emailAddresses
+                  >> item.accountPaths >> item.accountUris;
+}
 
-int matchLength(const QString &lhs, const QString &rhs)
+SnapshotItem snapshotItem(const SeasideCache::CacheItem &item, const QString &alternateDisplayLabel)
 {
-    if (lhs.isEmpty() || rhs.isEmpty())
-        return 0;
+    SnapshotItem rv;
+    rv.iid = item.iid;
+    // HasValidOnlineAccount is recalculated when the restored item is indexed
+    rv.statusFlags = item.statusFlags & ~static_cast<quint64>(SeasideCache::HasValidOnlineAccount);
+    rv.displayLabel = item.displayLabel;
+    rv.alternateDisplayLabel = alternateDisplayLabel;
+    rv.displayLabelGroup = item.displayLabelGroup;
 
-    QString::const_iterator lbegin = lhs.constBegin(), lend = lhs.constEnd();
-    QString::const_iterator rbegin = rhs.constBegin(), rend = rhs.constEnd();
-
-    // Do these numbers contain DTMF elements?
-    QString::const_iterator ldtmf = firstDtmfChar(lbegin, lend);
-    QString::const_iterator rdtmf = firstDtmfChar(rbegin, rend);
-
-    QString::const_iterator lit, rit;
-    bool processDtmf = false;
-    int matchLength = 0;
-
-    if ((ldtmf != lbegin) && (rdtmf != rbegin)) {
-        // Start match length calculation at the last non-DTMF digit
-        lit = ldtmf - 1;
-        rit = rdtmf - 1;
-
-        while (*lit == *rit) {
-            ++matchLength;
-
-            --lit;
-            --rit;
-            if ((lit == lbegin) || (rit == rbegin)) {
-                if (*lit == *rit) {
-                    ++matchLength;
-
-                    if ((lit == lbegin) && (rit == rbegin)) {
-                        // We have a complete, exact match - this must be the best match
-                        return ExactMatch;
-                    } else {
-                        // We matched all of one number - continue looking in the DTMF part
-                        processDtmf = true;
-                    }
-                }
-                break;
-            }
-        }
-    } else {
-        // Process the DTMF section for a match
-        processDtmf = true;
+    const QContactName name(item.contact.detail<QContactName>());
+    rv.firstName = name.firstName();
+    rv.lastName = name.lastName();
+
+    foreach (const QContactPhoneNumber &phoneNumber, item.contact.details<QContactPhoneNumber>()) {
+        rv.phoneNumbers.append(phoneNumber.number());
+    }
+    foreach (const QContactEmailAddress &emailAddress, item.contact.details<QContactEmailAddress>()) {
+        rv.emailAddresses.append(emailAddress.emailAddress());
+    }
+    foreach (const QContactOnlineAccount &account, item.contact.details<QContactOnlineAccount>()) {
+        rv.accountPaths.append(account.value<QString>(QContactOnlineAccount__FieldAccountPath));
+        rv.accountUris.append(account.accountUri());
     }
 
-    // Have we got a match?
-    if ((matchLength >= QtContactsSqliteExtensions::DefaultMaximumPhoneNumberCharacters) ||
-        processDtmf) {
-        // See if the match continues into the DTMF area
-        QString::const_iterator lit = ldtmf;
-        QString::const_iterator rit = rdtmf;
-        for ( ; (lit != lend) && (rit != rend); ++lit, ++rit) {
-            if ((*lit).toLower() != (*rit).toLower())
-                break;
-            ++matchLength;
-        }
+    return rv;
+}
+
+QContact snapshotContact(const SnapshotItem &item)
+{
+    static const QString aggregate(QString::fromLatin1("aggregate"));
+
+    QContact contact;
+    contact.setId(SeasideCache::apiId(item.iid));
+
+    // Only aggregates are listed by the cache
+    QContactSyncTarget syncTarget;
+    syncTarget.setSyncTarget(aggregate);
+    contact.saveDetail(&syncTarget);
+
+    QContactName name;
+    name.setFirstName(item.firstName);
+    name.setLastName(item.lastName);
+    contact.saveDetail(&name);
+
+    QContactDisplayLabel label;
+    label.setLabel(item.displayLabel);
+    label.setValue(QContactDisplayLabel__FieldLabelGroup, item.displayLabelGroup);
+    contact.saveDetail(&label);
+
+    QContactStatusFlags flags;
+    flags.setFlagsValue(item.statusFlags);
+    contact.saveDetail(&flags);
+
+    foreach (const QString &number, item.phoneNumbers) {
+        QContactPhoneNumber phoneNumber;
+        phoneNumber.setNumber(number);
+        contact.saveDetail(&phoneNumber);
+    }
+    foreach (const QString &address, item.emailAddresses) {
+        QContactEmailAddress emailAddress;
+        emailAddress.setEmailAddress(address);
+        contact.saveDetail(&emailAddress);
     }
+    for (int i = 0; i < item.accountUris.count() && i < item.accountPaths.count(); ++i) {
+        QContactOnlineAccount account;
+        account.setAccountUri(item.accountUris.at(i));
+        account.setValue(QContactOnlineAccount__FieldAccountPath, item.accountPaths.at(i));
+        contact.saveDetail(&account);
+    }
+
+    return contact;
+}
 
-    return matchLength;
+QString contactsDataPath()
+{
+    // The privileged location is used when the process has access to it
+    const QString systemPath(QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/system/"));
+    const QString privilegedPath(systemPath + QStringLiteral("privileged/Contacts/"));
+    return QDir(privilegedPath).exists() ? privilegedPath : systemPath + QStringLiteral("Contacts/");
 }
 
-int bestPhoneNumberMatchLength(const QContact &contact, const QString &match)
+QString snapshotPath()
 {
-    int bestMatchLength = 0;
+    // Test mode uses a separate database, which we should not mirror
+    if (!qgetenv("LIBCONTACTS_TEST_MODE").isEmpty())
+        return QString();
 
-    foreach (const QContactPhoneNumber& phone, contact.details<QContactPhoneNumber>()) {
-        bestMatchLength = qMax(bestMatchLength, matchLength(SeasideCache::normalizePhoneNumber(phone.number()), match));
-        if (bestMatchLength == ExactMatch) {
-            return ExactMatch;
+    // Store the snapshot alongside the database, so it has the same access restrictions
+    return contactsDataPath() + QStringLiteral("libcontacts/cache-snapshot");
+}
+
+QString localContactIndexPath()
+{
+    // The index holds contact names, so it has the same access restrictions as the snapshot
+    if (!qgetenv("LIBCONTACTS_TEST_MODE").isEmpty())
+        return QString();
+
+    return contactsDataPath() + QStringLiteral("libcontacts/local-contact-index");
+}
+
+Q_GLOBAL_STATIC_WITH_ARGS(SeasideLocalContactIndex, localContactIndex, (manager(), SeasideLocalContactIndex::localContactFilter(), localContactIndexPath()))
+
+QByteArray databaseChangeState()
+{
+    // Any write to the database modifies either the database file or its write-ahead log.
+    // A checkpoint can also change this state without changing content; that only costs
+    // us an unnecessary invalidation.
+    const QString databasePath(contactsDataPath() + QStringLiteral("qtcontacts-sqlite/contacts.db"));
+
+    QByteArray state;
+    foreach (const QString &suffix, QStringList() << QString() << QStringLiteral("-wal")) {
+        const QFileInfo info(databasePath + suffix);
+        if (info.exists()) {
+            state += QByteArray::number(info.size()) + ':' + QByteArray::number(info.lastModified().toMSecsSinceEpoch()) + ';';
+        } else if (suffix.isEmpty()) {
+            return QByteArray();
         }
     }
 
-    return bestMatchLength;
+    return state;
+}
+
+SeasideImportJob *pendingImportJob(const QList<SeasideImportJob *> &jobs)
+{
+    foreach (SeasideImportJob *job, jobs) {
+        if (job->hasPendingContacts())
+            return job;
+    }
+    return 0;
+}
+
+QString exportFilePath()
+{
+    QString baseDir;
+    foreach (const QString &loc, QStandardPaths::standardLocations(QStandardPaths::DocumentsLocation)) {
+        baseDir = loc;
+        break;
+    }
+    return baseDir
+         + QDir::separator()
+         + QLocale::c().toString(QDateTime::currentDateTime(), QStringLiteral("ss_mm_hh_dd_mm_yyyy"))
+         + ".vcf";
+}
+
+// Moves the ids appended after 'originalCount' to 'index', shifting the existing tail only once
+void insertAppended(QList<quint32> &ids, int index, int originalCount)
+{
+    if (index < originalCount)
+        std::rotate(ids.begin() + index, ids.begin() + originalCount, ids.end());
+}
+
+const char aboutToMoveItemsSignature[] = "sourceAboutToMoveItems(int,int,int)";
+const char itemsMovedSignature[] = "sourceItemsMoved()";
+const char aboutToResetItemsSignature[] = "sourceAboutToResetItems()";
+const char itemsResetSignature[] = "sourceItemsReset()";
+
+// Optional notifications are declared by models as invokable methods, rather than
+// as virtual functions of ListModel
+bool hasModelMethods(const QAbstractItemModel *model, const char *signature, const char *otherSignature)
+{
+    const QMetaObject *metaObject = model->metaObject();
+    return metaObject->indexOfMethod(signature) != -1
+        && metaObject->indexOfMethod(otherSignature) != -1;
+}
+
+bool handlesSourceMoves(const QAbstractItemModel *model)
+{
+    return hasModelMethods(model, aboutToMoveItemsSignature, itemsMovedSignature);
+}
+
+bool handlesSourceResets(const QAbstractItemModel *model)
+{
+    return hasModelMethods(model, aboutToResetItemsSignature, itemsResetSignature);
 }
 
+void invokeModelMethod(QAbstractItemModel *model, const char *signature,
+                       QGenericArgument arg0 = QGenericArgument(), QGenericArgument arg1 = QGenericArgument(), QGenericArgument arg2 = QGenericArgument())
+{
+    const QMetaObject *metaObject = model->metaObject();
+    metaObject->method(metaObject->indexOfMethod(signature)).invoke(model, Qt::DirectConnection, arg0, arg1, arg2);
+}
+
+// Synchronizes a cached list for models which cannot represent moves, so that items
+// which change position are removed and reinserted instead
+struct RemoveInsertAgent
+{
+    RemoveInsertAgent(SeasideCache *cache) : cache(cache) {}
+
+    int insertRange(int index, int count, const QList<quint32> &source, int sourceIndex) { return cache->insertRange(index, count, source, sourceIndex); }
+    int removeRange(int index, int count) { return cache->removeRange(index, count); }
+
+    SeasideCache *cache;
+};
+
 }
 
 SeasideCache *SeasideCache::instancePtr = 0;
@@ -503,6 +648,17 @@ QContactManager* SeasideCache::manager()
     return ::manager();
 }
 
+// True if manager is the one returned by manager(), which is not created to find out
+bool SeasideCache::isManager(const QContactManager *manager)
+{
+    return ::manager.exists() && manager == ::manager();
+}
+
+SeasideLocalContactIndex *SeasideCache::localContactIndex()
+{
+    return ::localContactIndex();
+}
+
 SeasideCache* SeasideCache::instance()
 {
     if (!instancePtr) {
@@ -539,10 +695,15 @@ quint32 SeasideCache::internalId(const QContactId &id)
 SeasideCache::SeasideCache()
     : m_syncFilter(FilterNone)
     , m_populated(0)
+    , m_provisionalFilters(0)
     , m_cacheIndex(0)
     , m_queryIndex(0)
     , m_fetchProcessedCount(0)
+    , m_priorityFetchProcessedCount(0)
+    , m_viewportFetchProcessedCount(0)
     , m_fetchByIdProcessedCount(0)
+    , m_appendCostNs(0)
+    , m_updateCostNs(0)
     , m_keepPopulated(false)
     , m_populateProgress(Unpopulated)
     , m_populating(0)
@@ -553,6 +714,11 @@ SeasideCache::SeasideCache()
     , m_refreshRequired(false)
     , m_contactsUpdated(false)
     , m_displayOff(false)
+    , m_snapshotDirty(false)
+    , m_searchIndexing(false)
+    , m_unknownAddressSequence(0)
+    , m_unknownAddressHits(0)
+    , m_unknownAddressMisses(0)
 {
     m_timer.start();
     m_fetchPostponed.invalidate();
@@ -596,12 +762,20 @@ SeasideCache::SeasideCache()
             this, SLOT(contactsRemoved(QList<QContactId>)));
 
     connect(&m_fetchRequest, SIGNAL(resultsAvailable()), this, SLOT(contactsAvailable()));
+    connect(&m_priorityFetchRequest, SIGNAL(resultsAvailable()), this, SLOT(contactsAvailable()));
+    connect(&m_viewportFetchRequest, SIGNAL(resultsAvailable()), this, SLOT(contactsAvailable()));
     connect(&m_fetchByIdRequest, SIGNAL(resultsAvailable()), this, SLOT(contactsAvailable()));
     connect(&m_contactIdRequest, SIGNAL(resultsAvailable()), this, SLOT(contactIdsAvailable()));
     connect(&m_relationshipsFetchRequest, SIGNAL(resultsAvailable()), this, SLOT(relationshipsAvailable()));
 
     connect(&m_fetchRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
             this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
+    connect(&m_priorityFetchRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
+            this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
+    connect(&m_viewportFetchRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
+            this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
+    connect(&m_populateIdRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
+            this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
     connect(&m_fetchByIdRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
             this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
     connect(&m_contactIdRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
@@ -610,27 +784,51 @@ SeasideCache::SeasideCache()
             this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
     connect(&m_removeRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
             this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
-    connect(&m_saveRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
-            this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
+    for (int i = 0; i < SaveRequestCount; ++i) {
+        connect(&m_saveRequests[i], SIGNAL(stateChanged(QContactAbstractRequest::State)),
+                this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
+    }
     connect(&m_relationshipSaveRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
             this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
     connect(&m_relationshipRemoveRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)),
             this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
 
     m_fetchRequest.setManager(mgr);
+    m_priorityFetchRequest.setManager(mgr);
+    m_viewportFetchRequest.setManager(mgr);
+    m_populateIdRequest.setManager(mgr);
     m_fetchByIdRequest.setManager(mgr);
     m_contactIdRequest.setManager(mgr);
     m_relationshipsFetchRequest.setManager(mgr);
     m_removeRequest.setManager(mgr);
-    m_saveRequest.setManager(mgr);
+    for (int i = 0; i < SaveRequestCount; ++i) {
+        m_saveRequests[i].setManager(mgr);
+        m_savingImportCounts[i] = 0;
+    }
     m_relationshipSaveRequest.setManager(mgr);
     m_relationshipRemoveRequest.setManager(mgr);
 
+    // Each populated list has its own request, so that they can be processed concurrently
+    for (int i = FilterAll; i < FilterTypesCount; ++i) {
+        QContactFetchRequest *request = &m_populateRequests[i];
+        connect(request, SIGNAL(resultsAvailable()), this, SLOT(contactsAvailable()));
+        connect(request, SIGNAL(stateChanged(QContactAbstractRequest::State)),
+                this, SLOT(requestStateChanged(QContactAbstractRequest::State)));
+        request->setManager(mgr);
+        m_populateProcessedCount[i] = 0;
+    }
+    for (int i = 0; i < FilterTypesCount; ++i) {
+        m_labelOrderRows[i] = 0;
+    }
+
     setSortOrder(sortProperty());
 }
 
 SeasideCache::~SeasideCache()
 {
+    if (m_snapshotDirty)
+        saveSnapshot();
+
     if (instancePtr == this)
         instancePtr = 0;
 }
@@ -638,7 +836,8 @@ SeasideCache::~SeasideCache()
 void SeasideCache::checkForExpiry()
 {
     if (instancePtr->m_users.isEmpty() && !QCoreApplication::closingDown()) {
-        bool unused = true;
+        // The cache owns any running jobs, so it must not expire until they finish
+        bool unused = instancePtr->m_importJobs.isEmpty() && instancePtr->m_exportJobs.isEmpty();
         for (int i = 0; i < FilterTypesCount; ++i) {
             unused &= instancePtr->m_models[i].isEmpty();
         }
@@ -671,9 +870,53 @@ void SeasideCache::unregisterModel(ListModel *model)
     for (int i = 0; i < FilterTypesCount; ++i)
         instancePtr->m_models[i].removeAll(model);
 
+    instancePtr->m_viewports.remove(model);
+
     checkForExpiry();
 }
 
+void SeasideCache::reportVisibleRange(ListModel *model, int first, int last, qreal velocity)
+{
+    if (!instancePtr)
+        return;
+
+    Viewport &viewport(instancePtr->m_viewports[model]);
+    viewport.first = first;
+    viewport.last = last;
+    viewport.velocity = velocity;
+
+    if (instancePtr->m_populateProgress != Populated) {
+        // If population began before any viewport was reported, the ordered IDs are still needed
+        if (instancePtr->m_populateProgress == Populating && instancePtr->viewportReported())
+            instancePtr->startPopulateIdRequest();
+
+        instancePtr->beginViewportPopulation();
+        instancePtr->prioritizeViewport(model);
+    }
+}
+
+void SeasideCache::reportVisibleDisplayLabelGroup(ListModel *model, const QString &group)
+{
+    if (!instancePtr)
+        return;
+
+    // Ensure the model is known to be reporting, even if it has no visible range yet
+    instancePtr->m_viewports[model];
+
+    if (instancePtr->m_populateProgress != Populated) {
+        if (instancePtr->m_populateProgress == Populating && instancePtr->viewportReported())
+            instancePtr->startPopulateIdRequest();
+
+        instancePtr->beginViewportPopulation();
+
+        // The members of the group may not have been loaded yet
+        if (!group.isEmpty() && instancePtr->m_contactDisplayLabelGroups.value(group).isEmpty()) {
+            instancePtr->m_viewportGroup = group;
+            instancePtr->requestUpdate();
+        }
+    }
+}
+
 void SeasideCache::registerUser(QObject *user)
 {
     // Ensure the cache has been instantiated
@@ -734,9 +977,16 @@ void SeasideCache::unregisterResolveListener(ResolveListener *listener)
     if (!instancePtr)
         return;
 
-    QHash<QContactFetchRequest *, ResolveData>::iterator it = instancePtr->m_resolveAddresses.begin();
+    QHash<QContactFetchRequest *, QList<ResolveData> >::iterator it = instancePtr->m_resolveAddresses.begin();
     while (it != instancePtr->m_resolveAddresses.end()) {
-        if (it.value().listener == listener) {
+        QList<ResolveData> &addresses(it.value());
+        for (int i = addresses.count() - 1; i >= 0; --i) {
+            if (addresses.at(i).listener == listener)
+                addresses.removeAt(i);
+        }
+
+        // Requests shared with other listeners must still complete
+        if (addresses.isEmpty()) {
             it.key()->cancel();
             delete it.key();
             it = instancePtr->m_resolveAddresses.erase(it);
@@ -745,12 +995,25 @@ void SeasideCache::unregisterResolveListener(ResolveListener *listener)
         }
     }
 
-    QList<ResolveData>::iterator it2 = instancePtr->m_unknownAddresses.begin();
-    while (it2 != instancePtr->m_unknownAddresses.end()) {
-        if (it2->listener == listener) {
-            it2 = instancePtr->m_unknownAddresses.erase(it2);
-        } else {
-            ++it2;
+    QList<ResolveData> *queues[] = { &instancePtr->m_batchResolveAddresses, &instancePtr->m_resolvedAddresses };
+    for (QList<ResolveData> *queue : queues) {
+        QList<ResolveData>::iterator it5 = queue->begin();
+        while (it5 != queue->end()) {
+            if (it5->listener == listener) {
+                it5 = queue->erase(it5);
+            } else {
+                ++it5;
+            }
+        }
+    }
+
+    // The addresses remain known to be unknown, but the listener should not be informed of them
+    QHash<QString, UnknownAddress>::iterator it2 = instancePtr->m_unknownAddresses.begin();
+    for ( ; it2 != instancePtr->m_unknownAddresses.end(); ++it2) {
+        QList<ResolveData> &listeners(it2->listeners);
+        for (int i = listeners.count() - 1; i >= 0; --i) {
+            if (listeners.at(i).listener == listener)
+                listeners.removeAt(i);
         }
     }
 
@@ -826,10 +1089,8 @@ SeasideCache::CacheItem *SeasideCache::itemById(const QContactId &id, bool requi
 
     CacheItem *item = 0;
 
-    QHash<quint32, CacheItem>::iterator it = instancePtr->m_people.find(iid);
-    if (it != instancePtr->m_people.end()) {
-        item = &(*it);
-    } else {
+    item = instancePtr->m_people.find(iid);
+    if (!item) {
         // Insert a new item into the cache if the one doesn't exist.
         item = &(instancePtr->m_people[iid]);
         item->iid = iid;
@@ -863,16 +1124,14 @@ SeasideCache::CacheItem *SeasideCache::existingItem(const QContactId &id)
 
 SeasideCache::CacheItem *SeasideCache::existingItem(quint32 iid)
 {
-    QHash<quint32, CacheItem>::iterator it = instancePtr->m_people.find(iid);
-    return it != instancePtr->m_people.end()
-            ? &(*it)
-            : 0;
+    return instancePtr->m_people.find(iid);
 }
 
 QContact SeasideCache::contactById(const QContactId &id)
 {
     quint32 iid = internalId(id);
-    return instancePtr->m_people.value(iid, CacheItem()).contact;
+    const CacheItem *item = instancePtr->m_people.find(iid);
+    return item ? item->contact : QContact();
 }
 
 void SeasideCache::ensureCompletion(CacheItem *cacheItem)
@@ -995,6 +1254,45 @@ SeasideCache::CacheItem *SeasideCache::resolveOnlineAccount(ResolveListener *lis
     return item;
 }
 
+void SeasideCache::resolvePhoneNumbers(ResolveListener *listener, const QStringList &numbers, bool requireComplete)
+{
+    // Ensure the cache has been instantiated
+    instance();
+
+    foreach (const QString &number, numbers) {
+        ResolveData data;
+        data.second = number;
+        data.requireComplete = requireComplete;
+        data.listener = listener;
+
+        // Don't bother trying to resolve an invalid number
+        if (normalizePhoneNumber(number).isEmpty()) {
+            instancePtr->m_unknownResolveAddresses.append(data);
+        } else {
+            instancePtr->m_batchResolveAddresses.append(data);
+        }
+    }
+
+    instancePtr->requestUpdate();
+}
+
+void SeasideCache::resolveEmailAddresses(ResolveListener *listener, const QStringList &addresses, bool requireComplete)
+{
+    // Ensure the cache has been instantiated
+    instance();
+
+    foreach (const QString &address, addresses) {
+        ResolveData data;
+        data.first = address;
+        data.requireComplete = requireComplete;
+        data.listener = listener;
+
+        instancePtr->m_batchResolveAddresses.append(data);
+    }
+
+    instancePtr->requestUpdate();
+}
+
 QContactId SeasideCache::selfContactId()
 {
     return manager()->selfContactId();
@@ -1086,6 +1384,7 @@ void SeasideCache::removeContactData(quint32 iid, FilterType filter)
         models.at(i)->sourceAboutToRemoveItems(row, row);
 
     m_contacts[filter].removeAt(row);
+    labelOrderRowsChanged(filter, row);
 
     for (int i = 0; i < models.count(); ++i)
         models.at(i)->sourceItemsRemoved();
@@ -1558,31 +1857,41 @@ void SeasideCache::startRequest(bool *idleProcessing)
 
     // Test these conditions in priority order
 
-    // Start by loading the favorites model, because it's so small and
-    // the user is likely to want to interact with it.
+    // Populate the cache by querying each list with its own request; the requests are
+    // all queued for the engine immediately, rather than waiting for each to complete.
+    // Favorites are queried first, because the list is so small and the user is likely
+    // to want to interact with it.
     if (m_keepPopulated && (m_populateProgress == Unpopulated)) {
-        if (m_fetchRequest.isActive()) {
-            requestPending = true;
+        startPopulateRequest(FilterFavorites);
+
+        if (m_provisionalFilters & (1 << FilterAll)) {
+            // The lists have been restored from the snapshot and are already presented
+            startPopulateRequest(FilterAll);
+            startPopulateRequest(FilterOnline);
+        } else if (viewportReported()) {
+            // A model is already showing the list; query the ordered IDs first, so that it can
+            // be presented immediately and its rows loaded ahead of the rest.  The content
+            // queries are started once the IDs are available.
+            startPopulateIdRequest();
         } else {
-            m_fetchRequest.setFilter(favoriteFilter());
-            m_fetchRequest.setFetchHint(favoriteFetchHint(m_fetchTypes));
-            m_fetchRequest.setSorting(m_sortOrder);
-            qDebug() << "Starting favorites query at" << m_timer.elapsed() << "ms";
-            m_fetchRequest.start();
+            startPopulateRequest(FilterAll);
+            startPopulateRequest(FilterOnline);
+        }
 
-            m_fetchProcessedCount = 0;
-            m_populateProgress = FetchFavorites;
-            m_dataTypesFetched |= m_fetchTypes;
-            m_populating = true;
+        for (int i = FilterAll; i < FilterTypesCount; ++i) {
+            m_populateProcessedCount[i] = 0;
+            m_populating |= (1 << i);
         }
+        m_populateProgress = Populating;
+        m_dataTypesFetched |= m_fetchTypes;
     }
 
     const int maxPriorityIds = 20;
 
-    // Next priority is refreshing small numbers of contacts,
-    // because these likely came from UI elements calling ensureCompletion()
+    // Next priority is refreshing small numbers of contacts, because these likely came
+    // from UI elements calling ensureCompletion(); these do not wait for population
     if (!m_changedContacts.isEmpty() && m_changedContacts.count() < maxPriorityIds) {
-        if (m_fetchRequest.isActive()) {
+        if (m_priorityFetchRequest.isActive()) {
             requestPending = true;
         } else {
             QContactIdFilter filter;
@@ -1591,45 +1900,25 @@ void SeasideCache::startRequest(bool *idleProcessing)
 
             // A local ID filter will fetch all contacts, rather than just aggregates;
             // we only want to retrieve aggregate contacts that have changed
-            m_fetchRequest.setFilter(filter & aggregateFilter());
-            m_fetchRequest.setFetchHint(basicFetchHint());
-            m_fetchRequest.setSorting(QList<QContactSortOrder>());
-            m_fetchRequest.start();
+            m_priorityFetchRequest.setFilter(filter & aggregateFilter());
+            m_priorityFetchRequest.setFetchHint(basicFetchHint());
+            m_priorityFetchRequest.setSorting(QList<QContactSortOrder>());
+            m_priorityFetchRequest.start();
 
-            m_fetchProcessedCount = 0;
+            m_priorityFetchProcessedCount = 0;
         }
     }
 
-    // Then populate the rest of the cache before doing anything else.
-    if (m_keepPopulated && (m_populateProgress != Populated)) {
-        if (m_fetchRequest.isActive()) {
+    // Fetch the contacts shown by models reporting their visible range
+    if (!m_viewportIds.isEmpty() || !m_viewportGroup.isEmpty()) {
+        if (m_viewportFetchRequest.isActive()) {
             requestPending = true;
         } else {
-            if (m_populateProgress == FetchMetadata) {
-                // Query for all contacts
-                // Request the metadata of all contacts (only data from the primary table, and any
-                // other details required to determine whether the contacts matches the filter)
-                m_fetchRequest.setFilter(allFilter());
-                m_fetchRequest.setFetchHint(metadataFetchHint(m_fetchTypes));
-                m_fetchRequest.setSorting(m_sortOrder);
-                qDebug() << "Starting metadata query at" << m_timer.elapsed() << "ms";
-                m_fetchRequest.start();
-
-                m_fetchProcessedCount = 0;
-                m_populating = true;
-            } else if (m_populateProgress == FetchOnline) {
-                // Now query for online contacts - fetch the account details, so we know if they're valid
-                m_fetchRequest.setFilter(onlineFilter());
-                m_fetchRequest.setFetchHint(onlineFetchHint(m_fetchTypes | SeasideCache::FetchAccountUri));
-                m_fetchRequest.setSorting(m_onlineSortOrder);
-                qDebug() << "Starting online  query at" << m_timer.elapsed() << "ms";
-                m_fetchRequest.start();
-
-                m_fetchProcessedCount = 0;
-                m_populating = true;
-            }
+            startViewportFetch();
         }
+    }
 
+    if (m_keepPopulated && (m_populateProgress != Populated)) {
         // Do nothing else until the cache is populated
         return;
     }
@@ -1699,23 +1988,39 @@ void SeasideCache::startRequest(bool *idleProcessing)
         }
     }
 
-    if (!m_contactsToCreate.isEmpty() || !m_contactsToSave.isEmpty()) {
-        if (m_saveRequest.isActive()) {
-            requestPending = true;
-        } else {
-            m_contactsToCreate.reserve(m_contactsToCreate.count() + m_contactsToSave.count());
+    // Saves are made in chunks of bounded size; while one chunk is being saved the next is
+    // queued behind it, so that the engine need not wait for it to be prepared
+    for (int i = 0; i < SaveRequestCount; ++i) {
+        QContactSaveRequest &saveRequest(m_saveRequests[i]);
+        if (saveRequest.isActive())
+            continue;
+
+        QList<QContact> contacts;
+        if (!m_contactsToCreate.isEmpty() || !m_contactsToSave.isEmpty()) {
+            const int createCount = qMin<int>(m_contactsToCreate.count(), MaxSaveChunkSize);
+            contacts = m_contactsToCreate.mid(0, createCount);
+            m_contactsToCreate.erase(m_contactsToCreate.begin(), m_contactsToCreate.begin() + createCount);
 
-            typedef QHash<QContactId, QContact>::iterator iterator;
-            for (iterator it = m_contactsToSave.begin(); it != m_contactsToSave.end(); ++it) {
-                m_contactsToCreate.append(*it);
+            QHash<QContactId, QContact>::iterator it = m_contactsToSave.begin();
+            while (it != m_contactsToSave.end() && contacts.count() < MaxSaveChunkSize) {
+                contacts.append(*it);
+                it = m_contactsToSave.erase(it);
             }
+        } else if (SeasideImportJob *importJob = pendingImportJob(m_importJobs)) {
+            // Imported contacts are saved one converted chunk per request
+            contacts = importJob->takeContacts();
+            m_savingImportJobs[i] = importJob;
+            m_savingImportCounts[i] = contacts.count();
+        } else {
+            break;
+        }
 
-            m_saveRequest.setContacts(m_contactsToCreate);
-            m_saveRequest.start();
+        saveRequest.setContacts(contacts);
+        saveRequest.start();
+    }
 
-            m_contactsToCreate.clear();
-            m_contactsToSave.clear();
-        }
+    if (!m_contactsToCreate.isEmpty() || !m_contactsToSave.isEmpty() || pendingImportJob(m_importJobs)) {
+        requestPending = true;
     }
 
     if (!m_constituentIds.isEmpty()) {
@@ -1895,6 +2200,10 @@ bool SeasideCache::event(QEvent *event)
     bool idleProcessing = false;
     startRequest(&idleProcessing);
 
+    if (!m_batchResolveAddresses.isEmpty()) {
+        resolveBatchAddresses();
+    }
+
     // Report any unknown addresses
     while (!m_unknownResolveAddresses.isEmpty()) {
         const ResolveData &resolve = m_unknownResolveAddresses.takeFirst();
@@ -1914,11 +2223,10 @@ bool SeasideCache::event(QEvent *event)
         if (!m_expiredContacts.isEmpty()) {
             QList<quint32> removeIds;
 
-            QHash<QContactId, int>::const_iterator it = m_expiredContacts.constBegin(), end = m_expiredContacts.constEnd();
+            QHash<quint32, int>::const_iterator it = m_expiredContacts.constBegin(), end = m_expiredContacts.constEnd();
             for ( ; it != end; ++it) {
                 if (it.value() < 0) {
-                    quint32 iid = internalId(it.key());
-                    removeIds.append(iid);
+                    removeIds.append(it.key());
                 }
             }
             m_expiredContacts.clear();
@@ -1936,15 +2244,23 @@ bool SeasideCache::event(QEvent *event)
 
             // Remove the contacts from the cache
             foreach (quint32 iid, removeIds) {
-                QHash<quint32, CacheItem>::iterator cacheItem = m_people.find(iid);
-                if (cacheItem != m_people.end()) {
+                if (CacheItem *cacheItem = m_people.find(iid)) {
                     delete cacheItem->itemData;
-                    m_people.erase(cacheItem);
+                    m_people.remove(iid);
+                    m_alternateDisplayLabels.remove(iid);
+                    m_searchIndex.remove(iid);
+                    m_dialpadIndex.remove(iid);
                 }
             }
 
             updateSectionBucketIndexCaches();
         }
+
+        if (m_snapshotDirty && !m_snapshotTimer.isActive()) {
+            // Record the updated state once activity has settled
+            static const int SnapshotDelayMs = 5000;
+            m_snapshotTimer.start(SnapshotDelayMs, this);
+        }
     }
     return true;
 }
@@ -1958,6 +2274,15 @@ void SeasideCache::timerEvent(QTimerEvent *event)
         }
     }
 
+    if (event->timerId() == m_snapshotTimer.timerId()) {
+        m_snapshotTimer.stop();
+        saveSnapshot();
+    }
+
+    if (event->timerId() == m_labelOrderTimer.timerId()) {
+        reportDisplayLabelOrderChanges();
+    }
+
     if (event->timerId() == m_expiryTimer.timerId()) {
         m_expiryTimer.stop();
         instancePtr = 0;
@@ -2039,7 +2364,7 @@ void SeasideCache::contactsRemoved(const QList<QContactId> &ids)
     } else {
         // Remove these contacts if they're already in the cache; they won't be removed by syncing
         foreach (const QContactId &id, presentIds) {
-            m_expiredContacts[id] += -1;
+            m_expiredContacts[internalId(id)] += -1;
         }
     }
 
@@ -2050,7 +2375,7 @@ void SeasideCache::dataChanged()
 {
     QList<QContactId> contactIds;
 
-    typedef QHash<quint32, CacheItem>::iterator iterator;
+    typedef CacheItemStore<CacheItem>::iterator iterator;
     for (iterator it = m_people.begin(); it != m_people.end(); ++it) {
         if (it->contactState != ContactAbsent)
             contactIds.append(it->apiId());
@@ -2147,14 +2472,89 @@ void SeasideCache::updateCache(CacheItem *item, const QContact &contact, bool pa
         item->contact = contact;
     }
 
-    item->displayLabel = generateDisplayLabel(item->contact, displayLabelOrder());
+    // Both labels are kept, so that a change of display label order does not regenerate them
+    const DisplayLabelOrder order(displayLabelOrder());
+    item->displayLabel = generateDisplayLabel(item->contact, order);
+    m_alternateDisplayLabels.insert(item->iid, generateDisplayLabel(item->contact, order == FirstNameFirst ? LastNameFirst : FirstNameFirst));
     item->displayLabelGroup = contact.detail<QContactDisplayLabel>().value(QContactDisplayLabel__FieldLabelGroup).toString();
 
+    updateSearchIndexing(item);
+
     if (!initialInsert) {
         reportItemUpdated(item);
     }
 }
 
+void SeasideCache::updateSearchIndexing(const CacheItem *item)
+{
+    if (!m_searchIndexing)
+        return;
+
+    QStringList text;
+    text.append(item->displayLabel);
+
+    const QContactName name(item->contact.detail<QContactName>());
+    text.append(name.firstName());
+    text.append(name.middleName());
+    text.append(name.lastName());
+
+    foreach (const QContactNickname &nickname, item->contact.details<QContactNickname>()) {
+        text.append(nickname.nickname());
+    }
+    foreach (const QContactOrganization &organization, item->contact.details<QContactOrganization>()) {
+        text.append(organization.name());
+    }
+    foreach (const QContactEmailAddress &emailAddress, item->contact.details<QContactEmailAddress>()) {
+        text.append(emailAddress.emailAddress());
+    }
+
+    // Numbers are matched by the dialpad both as entered and in normalized form; the normalized
+    // forms were already found when the numbers were indexed for resolution
+    const QStringList normalizedNumbers(m_phoneNumberIndex.normalizedNumbers(item->iid));
+    text.append(normalizedNumbers);
+
+    QStringList numbers(normalizedNumbers);
+    foreach (const QContactPhoneNumber &phoneNumber, item->contact.details<QContactPhoneNumber>()) {
+        numbers.append(phoneNumber.number());
+    }
+
+    m_searchIndex.insert(item->iid, text);
+    m_dialpadIndex.insert(item->iid, item->displayLabel, numbers);
+}
+
+// The search indexes are only built for clients which search, or which keep the cache populated
+void SeasideCache::ensureSearchIndexing()
+{
+    if (m_searchIndexing)
+        return;
+
+    m_searchIndexing = true;
+
+    typedef CacheItemStore<CacheItem>::iterator iterator;
+    for (iterator it = m_people.begin(); it != m_people.end(); ++it) {
+        if (it->contactState != ContactAbsent)
+            updateSearchIndexing(&*it);
+    }
+}
+
+QList<quint32> SeasideCache::searchContacts(const QString &query)
+{
+    // Ensure the cache has been instantiated
+    instance();
+    instancePtr->ensureSearchIndexing();
+
+    return instancePtr->m_searchIndex.search(query);
+}
+
+QList<quint32> SeasideCache::searchDialpad(const QString &digits)
+{
+    // Ensure the cache has been instantiated
+    instance();
+    instancePtr->ensureSearchIndexing();
+
+    return instancePtr->m_dialpadIndex.search(digits);
+}
+
 void SeasideCache::reportItemUpdated(CacheItem *item)
 {
     // Report the change to this contact
@@ -2171,37 +2571,79 @@ void SeasideCache::reportItemUpdated(CacheItem *item)
 
 void SeasideCache::resolveUnknownAddresses(const QString &first, const QString &second, CacheItem *item)
 {
-    QList<ResolveData>::iterator it = instancePtr->m_unknownAddresses.begin();
-    while (it != instancePtr->m_unknownAddresses.end()) {
-        bool resolved = false;
+    if (m_unknownAddresses.isEmpty())
+        return;
 
-        if (first == QString()) {
-            // This is a phone number - test in normalized form
-            resolved = (it->first == QString()) && (it->compare == second);
-        } else if (second == QString()) {
-            // Email address - compare in lowercased form
-            resolved = (it->compare == first) && (it->second == QString());
-        } else {
-            // Online account - compare URI in lowercased form
-            resolved = (it->first == first) && (it->compare == second);
+    QHash<QString, UnknownAddress>::iterator it = m_unknownAddresses.find(unknownAddressKey(first, second));
+    if (it == m_unknownAddresses.end())
+        return;
+
+    const QList<ResolveData> listeners(it->listeners);
+    m_unknownAddressUse.remove(it->sequence);
+    m_unknownAddresses.erase(it);
+
+    foreach (const ResolveData &data, listeners) {
+        // Inform the listener of resolution
+        data.listener->addressResolved(data.first, data.second, item);
+
+        // Do we need to request completion as well?
+        if (data.requireComplete) {
+            ensureCompletion(item);
         }
+    }
+}
+
+QString SeasideCache::unknownAddressKey(const QString &first, const QString &second)
+{
+    if (first.isEmpty()) {
+        return QStringLiteral("p:") + minimizePhoneNumber(second);
+    } else if (second.isEmpty()) {
+        return QStringLiteral("e:") + first.toLower();
+    }
+    return QStringLiteral("a:") + first + QLatin1Char('\n') + second.toLower();
+}
 
-        if (resolved) {
-            // Inform the listener of resolution
-            it->listener->addressResolved(it->first, it->second, item);
+void SeasideCache::recordUnknownAddress(const ResolveData &data)
+{
+    static const int MaxUnknownAddresses = 2000;
 
-            // Do we need to request completion as well?
-            if (it->requireComplete) {
-                ensureCompletion(item);
-            }
+    const QString key(unknownAddressKey(data.first, data.second));
+    UnknownAddress &entry(m_unknownAddresses[key]);
+    if (entry.sequence) {
+        m_unknownAddressUse.remove(entry.sequence);
+    }
+    entry.sequence = ++m_unknownAddressSequence;
+    entry.recorded = m_timer.elapsed();
+    m_unknownAddressUse.insert(entry.sequence, key);
+
+    if (!entry.listeners.contains(data)) {
+        entry.listeners.append(data);
+    }
 
-            it = instancePtr->m_unknownAddresses.erase(it);
+    // Evict the least recently used addresses; those still awaited by listeners are kept, so that
+    // the listeners are informed if the address becomes known
+    QMap<quint64, QString>::iterator oldest = m_unknownAddressUse.begin();
+    while (m_unknownAddresses.count() > MaxUnknownAddresses && oldest != m_unknownAddressUse.end()) {
+        QHash<QString, UnknownAddress>::iterator it = m_unknownAddresses.find(oldest.value());
+        if (it->listeners.isEmpty()) {
+            m_unknownAddresses.erase(it);
+            oldest = m_unknownAddressUse.erase(oldest);
         } else {
-            ++it;
+            ++oldest;
         }
     }
 }
 
+int SeasideCache::unknownAddressHits()
+{
+    return instancePtr ? instancePtr->m_unknownAddressHits : 0;
+}
+
+int SeasideCache::unknownAddressMisses()
+{
+    return instancePtr ? instancePtr->m_unknownAddressMisses : 0;
+}
+
 bool SeasideCache::updateContactIndexing(const QContact &oldContact, const QContact &contact, quint32 iid, const QSet<QContactDetail::DetailType> &queryDetailTypes, CacheItem *item)
 {
     bool modified = false;
@@ -2209,17 +2651,24 @@ bool SeasideCache::updateContactIndexing(const QContact &oldContact, const QCont
     QSet<StringPair> oldAddresses;
 
     if (queryDetailTypes.isEmpty() || queryDetailTypes.contains(detailType<QContactPhoneNumber>())) {
+        // The index key and normalized form of each number; several numbers may share a key
+        QSet<StringPair> oldNumbers;
+
         // Addresses which are no longer in the contact should be de-indexed
         foreach (const QContactPhoneNumber &phoneNumber, oldContact.details<QContactPhoneNumber>()) {
-            foreach (const StringPair &address, addressPairs(phoneNumber)) {
-                if (validAddressPair(address))
+            const QString normalized(normalizePhoneNumber(phoneNumber.number()));
+            foreach (const StringPair &address, addressPairs(normalized)) {
+                if (validAddressPair(address)) {
                     oldAddresses.insert(address);
+                    oldNumbers.insert(qMakePair(address.second, normalized));
+                }
             }
         }
 
         // Update our address indexes for any address details in this contact
         foreach (const QContactPhoneNumber &phoneNumber, contact.details<QContactPhoneNumber>()) {
-            foreach (const StringPair &address, addressPairs(phoneNumber)) {
+            const QString normalized(normalizePhoneNumber(phoneNumber.number()));
+            foreach (const StringPair &address, addressPairs(normalized)) {
                 if (!validAddressPair(address))
                     continue;
 
@@ -2229,18 +2678,16 @@ bool SeasideCache::updateContactIndexing(const QContact &oldContact, const QCont
                     resolveUnknownAddresses(address.first, address.second, item);
                 }
 
-                CachedPhoneNumber cachedPhoneNumber(normalizePhoneNumber(phoneNumber.number()), iid);
-
-                if (!m_phoneNumberIds.contains(address.second, cachedPhoneNumber))
-                    m_phoneNumberIds.insert(address.second, cachedPhoneNumber);
+                if (!oldNumbers.remove(qMakePair(address.second, normalized)))
+                    m_phoneNumberIndex.insert(address.second, normalized, iid);
             }
         }
 
-        // Remove any addresses no longer available for this contact
-        if (!oldAddresses.isEmpty()) {
+        // Remove any numbers no longer available for this contact
+        if (!oldAddresses.isEmpty() || !oldNumbers.isEmpty()) {
             modified = true;
-            foreach (const StringPair &address, oldAddresses) {
-                m_phoneNumberIds.remove(address.second);
+            foreach (const StringPair &number, oldNumbers) {
+                m_phoneNumberIndex.remove(number.first, number.second, iid);
             }
             oldAddresses.clear();
         }
@@ -2338,6 +2785,8 @@ void SeasideCache::contactsAvailable()
 {
     QContactAbstractRequest *request = static_cast<QContactAbstractRequest *>(sender());
 
+    const FilterType type(populateFilter(request));
+
     QList<QContact> contacts;
     QContactFetchHint fetchHint;
     if (request == &m_fetchByIdRequest) {
@@ -2348,23 +2797,25 @@ void SeasideCache::contactsAvailable()
         m_fetchByIdProcessedCount += contacts.count();
         fetchHint = m_fetchByIdRequest.fetchHint();
     } else {
-        contacts = m_fetchRequest.contacts();
-        if (m_fetchProcessedCount) {
-            contacts = contacts.mid(m_fetchProcessedCount);
+        QContactFetchRequest *fetchRequest = static_cast<QContactFetchRequest *>(request);
+        int &processedCount(type != FilterNone ? m_populateProcessedCount[type]
+                                               : (fetchRequest == &m_priorityFetchRequest ? m_priorityFetchProcessedCount
+                                                                                          : (fetchRequest == &m_viewportFetchRequest ? m_viewportFetchProcessedCount
+                                                                                                                                     : m_fetchProcessedCount)));
+        contacts = fetchRequest->contacts();
+        if (processedCount) {
+            contacts = contacts.mid(processedCount);
         }
-        m_fetchProcessedCount += contacts.count();
-        fetchHint = m_fetchRequest.fetchHint();
+        processedCount += contacts.count();
+        fetchHint = fetchRequest->fetchHint();
     }
     if (contacts.isEmpty())
         return;
 
     QSet<QContactDetail::DetailType> queryDetailTypes = detailTypesHint(fetchHint).toSet();
 
-    if (request == &m_fetchRequest && m_populating) {
-        Q_ASSERT(m_populateProgress > Unpopulated && m_populateProgress < Populated);
-        FilterType type(m_populateProgress == FetchFavorites ? FilterFavorites
-                                                             : (m_populateProgress == FetchMetadata ? FilterAll
-                                                                                                    : FilterOnline));
+    if (type != FilterNone) {
+        Q_ASSERT(m_populateProgress == Populating);
         QHash<FilterType, QPair<QSet<QContactDetail::DetailType>, QList<QContact> > >::iterator it = m_contactsToAppend.find(type);
         if (it != m_contactsToAppend.end()) {
             // All populate queries have the same detail types, so we can append this list to the existing one
@@ -2374,7 +2825,7 @@ void SeasideCache::contactsAvailable()
         }
         requestUpdate();
     } else {
-        if (contacts.count() == 1 || request == &m_fetchByIdRequest) {
+        if (contacts.count() == 1 || request == &m_fetchByIdRequest || request == &m_priorityFetchRequest || request == &m_viewportFetchRequest) {
             // Process these results immediately
             applyContactUpdates(contacts, queryDetailTypes);
             updateSectionBucketIndexCaches(); // note: can cause out-of-order since this doesn't result in refresh request.  TODO: remove this line?
@@ -2396,78 +2847,119 @@ void SeasideCache::contactsAvailable()
     }
 }
 
+int SeasideCache::updateSliceSize(qint64 contactCostNs, qint64 remainingNs, int initialSize)
+{
+    // Keep the size bounded, since an unexpectedly costly slice cannot be interrupted
+    const int maxSliceSize = 500;
+
+    if (contactCostNs <= 0)
+        return initialSize;
+
+    return static_cast<int>(qBound<qint64>(1, remainingNs / contactCostNs, maxSliceSize));
+}
+
+void SeasideCache::recordUpdateCost(qint64 *contactCostNs, int count, qint64 elapsedNs)
+{
+    if (count <= 0)
+        return;
+
+    // Track a moving average, so that a single slow slice does not dominate the estimate
+    const qint64 sample = qMax<qint64>(elapsedNs / count, 1);
+    *contactCostNs = (*contactCostNs > 0) ? ((*contactCostNs * 3) + sample) / 4 : sample;
+}
+
 void SeasideCache::applyPendingContactUpdates()
 {
-    if (!m_contactsToAppend.isEmpty()) {
-        // Insert the contacts in the order they're requested
-        QHash<FilterType, QPair<QSet<QContactDetail::DetailType>, QList<QContact> > >::iterator end = m_contactsToAppend.end(), it = end;
-        if ((it = m_contactsToAppend.find(FilterFavorites)) != end) {
-        } else if ((it = m_contactsToAppend.find(FilterAll)) != end) {
-        } else {
-            it = m_contactsToAppend.find(FilterOnline);
-        }
-        Q_ASSERT(it != end);
+    // Apply as many updates as will fit within the frame budget; the cost of each update
+    // includes the model signals and any QML binding re-evaluation they cause, so we
+    // measure the real cost of each slice rather than using a fixed batch size
+    const qint64 budgetNs = static_cast<qint64>(cacheConfig()->updateFrameBudget()) * 1000000;
 
-        FilterType type = it.key();
-        QSet<QContactDetail::DetailType> &detailTypes((*it).first);
-        const bool partialFetch = !detailTypes.isEmpty();
+    QElapsedTimer frameTimer;
+    frameTimer.start();
 
-        QList<QContact> &appendedContacts((*it).second);
+    do {
+        const qint64 remainingNs = budgetNs - frameTimer.nsecsElapsed();
 
-        const int maxBatchSize = 200;
-        const int minBatchSize = 50;
+        QElapsedTimer sliceTimer;
+        sliceTimer.start();
 
-        if (appendedContacts.count() < maxBatchSize) {
-            // For a small number of contacts, append all at once
-            appendContacts(appendedContacts, type, partialFetch, detailTypes);
-            appendedContacts.clear();
-        } else {
-            // Append progressively in batches
-            appendContacts(appendedContacts.mid(0, minBatchSize), type, partialFetch, detailTypes);
-            appendedContacts = appendedContacts.mid(minBatchSize);
-        }
-
-        if (appendedContacts.isEmpty()) {
-            m_contactsToAppend.erase(it);
-
-            // This list has been processed - have we finished populating the group?
-            if (type == FilterFavorites && (m_populateProgress != FetchFavorites)) {
-                makePopulated(FilterFavorites);
-                qDebug() << "Favorites queried in" << m_timer.elapsed() << "ms";
-            } else if (type == FilterAll && (m_populateProgress != FetchMetadata)) {
-                makePopulated(FilterNone);
-                makePopulated(FilterAll);
-                qDebug() << "All queried in" << m_timer.elapsed() << "ms";
-            } else if (type == FilterOnline && (m_populateProgress != FetchOnline)) {
-                makePopulated(FilterOnline);
-                qDebug() << "Online queried in" << m_timer.elapsed() << "ms";
+        if (!m_contactsToAppend.isEmpty()) {
+            // Insert the contacts in the order they're requested
+            QHash<FilterType, QPair<QSet<QContactDetail::DetailType>, QList<QContact> > >::iterator end = m_contactsToAppend.end(), it = end;
+            if ((it = m_contactsToAppend.find(FilterFavorites)) != end) {
+            } else if ((it = m_contactsToAppend.find(FilterAll)) != end) {
+            } else {
+                it = m_contactsToAppend.find(FilterOnline);
             }
-            updateSectionBucketIndexCaches();
-        }
-    } else {
-        QList<QPair<QSet<QContactDetail::DetailType>, QList<QContact> > >::iterator it = m_contactsToUpdate.begin();
+            Q_ASSERT(it != end);
 
-        QSet<QContactDetail::DetailType> &detailTypes((*it).first);
+            FilterType type = it.key();
+            QSet<QContactDetail::DetailType> &detailTypes((*it).first);
+            const bool partialFetch = !detailTypes.isEmpty();
 
-        // Update a single contact at a time; the update can cause numerous QML bindings
-        // to be re-evaluated, so even a single contact update might be a slow operation
-        QList<QContact> &updatedContacts((*it).second);
-        applyContactUpdates(QList<QContact>() << updatedContacts.takeFirst(), detailTypes);
+            QList<QContact> &appendedContacts((*it).second);
 
-        if (updatedContacts.isEmpty()) {
-            m_contactsToUpdate.erase(it);
-            updateSectionBucketIndexCaches();
+            const int initialSliceSize = 50;
+            const int count = qMin(appendedContacts.count(), updateSliceSize(m_appendCostNs, remainingNs, initialSliceSize));
+
+            if (count == appendedContacts.count()) {
+                appendContacts(appendedContacts, type, partialFetch, detailTypes);
+                appendedContacts.clear();
+            } else {
+                // Append progressively in slices
+                appendContacts(appendedContacts.mid(0, count), type, partialFetch, detailTypes);
+                appendedContacts.erase(appendedContacts.begin(), appendedContacts.begin() + count);
+            }
+
+            if (appendedContacts.isEmpty()) {
+                m_contactsToAppend.erase(it);
+
+                // This list has been processed - have we finished populating the group?
+                if ((m_populating & (1 << type)) == 0) {
+                    populationComplete(type);
+                }
+                updateSectionBucketIndexCaches();
+            }
+
+            recordUpdateCost(&m_appendCostNs, count, sliceTimer.nsecsElapsed());
+        } else {
+            QList<QPair<QSet<QContactDetail::DetailType>, QList<QContact> > >::iterator it = m_contactsToUpdate.begin();
+
+            QSet<QContactDetail::DetailType> &detailTypes((*it).first);
+
+            // Until the cost of an update has been measured, update a single contact at a time;
+            // the update can cause numerous QML bindings to be re-evaluated, so even a single
+            // contact update might be a slow operation
+            QList<QContact> &updatedContacts((*it).second);
+
+            const int initialSliceSize = 1;
+            const int count = qMin(updatedContacts.count(), updateSliceSize(m_updateCostNs, remainingNs, initialSliceSize));
+
+            applyContactUpdates(updatedContacts.mid(0, count), detailTypes);
+            updatedContacts.erase(updatedContacts.begin(), updatedContacts.begin() + count);
+
+            if (updatedContacts.isEmpty()) {
+                m_contactsToUpdate.erase(it);
+                updateSectionBucketIndexCaches();
+            }
+
+            recordUpdateCost(&m_updateCostNs, count, sliceTimer.nsecsElapsed());
         }
-    }
+    } while ((!m_contactsToAppend.isEmpty() || !m_contactsToUpdate.isEmpty()) && frameTimer.nsecsElapsed() < budgetNs);
 }
 
 void SeasideCache::updateSectionBucketIndexCaches()
 {
-    for (int i = 0; i < FilterTypesCount; ++i) {
-        const QList<ListModel *> &models = m_models[i];
-        for (ListModel *model : models) {
-            model->updateSectionBucketIndexCache();
-        }
+    for (int i = 0; i < FilterTypesCount; ++i)
+        updateSectionBucketIndexCaches(static_cast<FilterType>(i));
+}
+
+void SeasideCache::updateSectionBucketIndexCaches(FilterType filter)
+{
+    const QList<ListModel *> &models = m_models[filter];
+    for (ListModel *model : models) {
+        model->updateSectionBucketIndexCache();
     }
 }
 
@@ -2476,6 +2968,8 @@ void SeasideCache::applyContactUpdates(const QList<QContact> &contacts, const QS
     QSet<QString> modifiedGroups;
     const bool partialFetch = !queryDetailTypes.isEmpty();
 
+    m_snapshotDirty |= !contacts.isEmpty();
+
     foreach (QContact contact, contacts) {
         quint32 iid = internalId(contact);
 
@@ -2575,7 +3069,8 @@ void SeasideCache::contactIdsAvailable()
             }
         }
     } else {
-        synchronizeList(this, m_contacts[m_syncFilter], m_cacheIndex, internalIds(m_contactIdRequest.ids()), m_queryIndex);
+        synchronizeContacts(internalIds(m_contactIdRequest.ids()), m_cacheIndex, m_queryIndex);
+        updateSectionBucketIndexCaches(m_syncFilter);
     }
 }
 
@@ -2598,19 +3093,22 @@ void SeasideCache::removeRange(FilterType filter, int index, int count)
     for (int i = 0; i < models.count(); ++i)
         models[i]->sourceAboutToRemoveItems(index, index + count - 1);
 
-    for (int i = 0; i < count; ++i) {
-        if (filter == FilterAll) {
-            const quint32 iid = cacheIds.at(index);
-            m_expiredContacts[apiId(iid)] -= 1;
-        }
+    m_snapshotDirty = true;
+
+    const QList<quint32>::iterator first = cacheIds.begin() + index;
+    const QList<quint32>::iterator last = first + count;
 
-        cacheIds.removeAt(index);
+    if (filter == FilterAll) {
+        for (QList<quint32>::const_iterator it = first; it != last; ++it)
+            m_expiredContacts[*it] -= 1;
     }
 
-    for (int i = 0; i < models.count(); ++i) {
+    // Erase the whole range at once, so the tail is shifted only once
+    cacheIds.erase(first, last);
+    labelOrderRowsChanged(filter, index);
+
+    for (int i = 0; i < models.count(); ++i)
         models[i]->sourceItemsRemoved();
-        models[i]->updateSectionBucketIndexCache();
-    }
 }
 
 int SeasideCache::insertRange(FilterType filter, int index, int count, const QList<quint32> &queryIds, int queryIndex)
@@ -2624,30 +3122,87 @@ int SeasideCache::insertRange(FilterType filter, int index, int count, const QLi
     for (int i = 0; i < models.count(); ++i)
         models[i]->sourceAboutToInsertItems(index, end);
 
+    m_snapshotDirty = true;
+
+    const int originalCount = cacheIds.count();
+    cacheIds.reserve(originalCount + count);
+
     for (int i = 0; i < count; ++i) {
         quint32 iid = queryIds.at(queryIndex + i);
         if (iid == selfId)
             continue;
 
-        if (filter == FilterAll) {
-            const QContactId apiId = SeasideCache::apiId(iid);
-            m_expiredContacts[apiId] += 1;
-        }
+        if (filter == FilterAll)
+            m_expiredContacts[iid] += 1;
 
-        cacheIds.insert(index + i, iid);
+        cacheIds.append(iid);
     }
 
-    for (int i = 0; i < models.count(); ++i) {
+    insertAppended(cacheIds, index, originalCount);
+    labelOrderRowsChanged(filter, index);
+
+    for (int i = 0; i < models.count(); ++i)
         models[i]->sourceItemsInserted(index, end);
-        models[i]->updateSectionBucketIndexCache();
-    }
 
     return end - index + 1;
 }
 
+void SeasideCache::moveRange(FilterType filter, int index, int count, int destination)
+{
+    // Only used when every model of the filter handles moves; see synchronizeContacts()
+    QList<quint32> &cacheIds = m_contacts[filter];
+    QList<ListModel *> &models = m_models[filter];
+
+    for (int i = 0; i < models.count(); ++i)
+        invokeModelMethod(models[i], aboutToMoveItemsSignature, Q_ARG(int, index), Q_ARG(int, index + count - 1), Q_ARG(int, destination));
+
+    m_snapshotDirty = true;
+
+    // Rotate the moved block into place without removing anything
+    const QList<quint32>::iterator first = cacheIds.begin() + index;
+    if (destination > index) {
+        std::rotate(first, first + count, cacheIds.begin() + destination);
+    } else {
+        std::rotate(cacheIds.begin() + destination, first, first + count);
+    }
+    labelOrderRowsChanged(filter, qMin(index, destination));
+
+    for (int i = 0; i < models.count(); ++i)
+        invokeModelMethod(models[i], itemsMovedSignature);
+}
+
+// Applies the differences between the cached list for m_syncFilter and the queried ids,
+// reporting items which change position as moves if every model can represent them
+void SeasideCache::synchronizeContacts(const QList<quint32> &queryIds, int &cacheIndex, int &queryIndex)
+{
+    bool handlesMoves = true;
+    const QList<ListModel *> &models = m_models[m_syncFilter];
+    for (int i = 0; i < models.count(); ++i)
+        handlesMoves &= handlesSourceMoves(models.at(i));
+
+    if (handlesMoves) {
+        synchronizeList<AnchoredSynchronizeList>(this, m_contacts[m_syncFilter], cacheIndex, queryIds, queryIndex);
+    } else {
+        RemoveInsertAgent agent(this);
+        synchronizeList<AnchoredSynchronizeList>(&agent, m_contacts[m_syncFilter], cacheIndex, queryIds, queryIndex);
+    }
+}
+
 void SeasideCache::appendContacts(const QList<QContact> &contacts, FilterType filterType, bool partialFetch, const QSet<QContactDetail::DetailType> &queryDetailTypes)
 {
+    if (m_provisionalFilters & (1 << filterType)) {
+        // This list was restored from the snapshot; update the existing items now, and
+        // reconcile the list order when the query is complete
+        foreach (const QContact &contact, contacts) {
+            m_populateIds[filterType].append(internalId(contact));
+        }
+        applyContactUpdates(contacts, queryDetailTypes);
+        return;
+    }
+
     if (!contacts.isEmpty()) {
+        m_snapshotDirty = true;
+
         QList<quint32> &cacheIds = m_contacts[filterType];
         QList<ListModel *> &models = m_models[filterType];
 
@@ -2704,6 +3259,53 @@ void SeasideCache::notifySaveContactComplete(int constituentId, int aggregateId)
     }
 }
 
+void SeasideCache::fetchSavedAggregates(const QList<QContact> &contacts)
+{
+    QList<QContactId> constituentIds;
+    constituentIds.reserve(contacts.count());
+    foreach (const QContact &contact, contacts) {
+        constituentIds.append(apiId(contact));
+    }
+
+    // Find the aggregates of all the saved constituents with a single query, rather
+    // than a relationship fetch for each of them
+    QContactFetchHint fetchHint;
+    setDetailTypesHint(fetchHint, DetailList() << detailType<QContactSyncTarget>());
+    fetchHint.setRelationshipTypesHint(QStringList() << aggregateRelationshipType);
+    fetchHint.setOptimizationHints(QContactFetchHint::NoActionPreferences | QContactFetchHint::NoBinaryBlobs);
+
+    QContactFetchByIdRequest *request = new QContactFetchByIdRequest(this);
+    request->setManager(manager());
+    request->setIds(constituentIds);
+    request->setFetchHint(fetchHint);
+    connect(request, &QContactAbstractRequest::stateChanged, this, [this, constituentIds, request] {
+        if (request->state() != QContactAbstractRequest::FinishedState)
+            return;
+
+        request->deleteLater();
+
+        // The fetched contacts correspond to the requested ids by index
+        const QList<QContact> fetched(request->contacts());
+        for (int i = 0; i < constituentIds.count(); ++i) {
+            const QContactId &constituentId(constituentIds.at(i));
+
+            int aggregateId = -1;
+            if (i < fetched.count()) {
+                foreach (const QContactRelationship &relationship, fetched.at(i).relationships(aggregateRelationshipType)) {
+                    if (apiId(relationship.second()) == constituentId) {
+                        aggregateId = internalId(apiId(relationship.first()));
+                        break;
+                    }
+                }
+            }
+
+            // An aggregate which cannot be found for the new constituent is reported as -1
+            this->notifySaveContactComplete(internalId(constituentId), aggregateId);
+        }
+    });
+    request->start();
+}
+
 void SeasideCache::requestStateChanged(QContactAbstractRequest::State state)
 {
     if (state != QContactAbstractRequest::FinishedState)
@@ -2711,6 +3313,12 @@ void SeasideCache::requestStateChanged(QContactAbstractRequest::State state)
 
     QContactAbstractRequest *request = static_cast<QContactAbstractRequest *>(sender());
 
+    int saveIndex = -1;
+    for (int i = 0; i < SaveRequestCount; ++i) {
+        if (request == &m_saveRequests[i])
+            saveIndex = i;
+    }
+
     if (request == &m_relationshipsFetchRequest) {
         if (!m_contactsToFetchConstituents.isEmpty()) {
             QContactId aggregateId = m_contactsToFetchConstituents.takeFirst();
@@ -2748,6 +3356,7 @@ void SeasideCache::requestStateChanged(QContactAbstractRequest::State state)
         if (m_syncFilter != FilterNone) {
             // We have completed fetching this filter set
             completeSynchronizeList(this, m_contacts[m_syncFilter], m_cacheIndex, internalIds(m_contactIdRequest.ids()), m_queryIndex);
+            updateSectionBucketIndexCaches(m_syncFilter);
 
             // Notify models of completed updates
             QList<ListModel *> &models = m_models[m_syncFilter];
@@ -2815,66 +3424,83 @@ void SeasideCache::requestStateChanged(QContactAbstractRequest::State state)
 
             m_aggregatedContacts.clear();
         }
-    } else if (request == &m_fetchRequest) {
-        if (m_populating) {
-            Q_ASSERT(m_populateProgress > Unpopulated && m_populateProgress < Populated);
-            if (m_populateProgress == FetchFavorites) {
-                if (m_contactsToAppend.find(FilterFavorites) == m_contactsToAppend.end()) {
-                    // No pending contacts, the models are now populated
-                    makePopulated(FilterFavorites);
-                    qDebug() << "Favorites queried in" << m_timer.elapsed() << "ms";
-                }
+    } else if (request == &m_populateIdRequest) {
+        m_populateOrder = internalIds(m_populateIdRequest.ids());
+        qDebug() << "IDs queried in" << m_timer.elapsed() << "ms";
 
-                m_populateProgress = FetchMetadata;
-            } else if (m_populateProgress == FetchMetadata) {
-                if (m_contactsToAppend.find(FilterAll) == m_contactsToAppend.end()) {
-                    makePopulated(FilterNone);
-                    makePopulated(FilterAll);
-                    qDebug() << "All queried in" << m_timer.elapsed() << "ms";
-                }
+        beginViewportPopulation();
 
-                m_populateProgress = FetchOnline;
-            } else if (m_populateProgress == FetchOnline) {
-                if (m_contactsToAppend.find(FilterOnline) == m_contactsToAppend.end()) {
-                    makePopulated(FilterOnline);
-                    qDebug() << "Online queried in" << m_timer.elapsed() << "ms";
-                }
+        // Queue the fetch for any visible contacts ahead of the content queries, unless
+        // those were started before the viewport was reported
+        if ((!m_viewportIds.isEmpty() || !m_viewportGroup.isEmpty()) && !m_viewportFetchRequest.isActive()) {
+            startViewportFetch();
+        }
+        if (m_populateRequests[FilterAll].state() == QContactAbstractRequest::InactiveState) {
+            startPopulateRequest(FilterAll);
+            startPopulateRequest(FilterOnline);
+        }
+    } else if (populateFilter(request) != FilterNone) {
+        Q_ASSERT(m_populateProgress == Populating);
+        const FilterType type(populateFilter(request));
+        m_populating &= ~(1 << type);
+
+        if (m_contactsToAppend.find(type) == m_contactsToAppend.end()) {
+            // No pending contacts, the models are now populated
+            populationComplete(type);
+        }
 
-                m_populateProgress = Populated;
-            }
-            m_populating = false;
+        if (m_populating == 0) {
+            m_populateProgress = Populated;
         }
-    } else if (request == &m_saveRequest) {
-        for (int i = 0; i < m_saveRequest.contacts().size(); ++i) {
-            const QContact c = m_saveRequest.contacts().at(i);
-            if (m_saveRequest.errorMap().value(i) != QContactManager::NoError) {
+    } else if (saveIndex != -1) {
+        QContactSaveRequest &saveRequest(m_saveRequests[saveIndex]);
+        const QMap<int, QContactManager::Error> errors(saveRequest.errorMap());
+
+        if (m_savingImportJobs[saveIndex]) {
+            m_savingImportJobs[saveIndex]->contactsSaveFinished(m_savingImportCounts[saveIndex], errors.count());
+            m_savingImportJobs[saveIndex] = 0;
+            m_savingImportCounts[saveIndex] = 0;
+        }
+
+        QList<QContact> constituents;
+        QList<QContactId> savedIds;
+        for (int i = 0; i < saveRequest.contacts().size(); ++i) {
+            const QContact c = saveRequest.contacts().at(i);
+            if (errors.value(i) == QContactManager::NoError) {
+                savedIds.append(c.id());
+            }
+
+            if (errors.value(i) != QContactManager::NoError) {
                 notifySaveContactComplete(-1, -1);
             } else if (c.detail<QContactSyncTarget>().syncTarget() == QStringLiteral("aggregate")) {
                 // In case an aggregate is saved rather than a local constituent,
                 // no need to look up the aggregate via a relationship fetch request.
                 notifySaveContactComplete(-1, internalId(c));
             } else {
-                // Get the aggregate associated with this contact.
-                QContactRelationshipFetchRequest *rfr = new QContactRelationshipFetchRequest(this);
-                rfr->setManager(m_saveRequest.manager());
-                rfr->setRelationshipType(QContactRelationship::Aggregates());
-                rfr->setSecond(c);
-                connect(rfr, &QContactAbstractRequest::stateChanged, this, [this, c, rfr] {
-                    if (rfr->state() == QContactAbstractRequest::FinishedState) {
-                        rfr->deleteLater();
-                        if (rfr->relationships().size()) {
-                            const quint32 constituentId = internalId(apiId(rfr->relationships().at(0).second()));
-                            const quint32 aggregateId = internalId(apiId(rfr->relationships().at(0).first()));
-                            this->notifySaveContactComplete(constituentId, aggregateId);
-                        } else {
-                            // error: cannot retrieve aggregate for newly created constituent.
-                            this->notifySaveContactComplete(internalId(c), -1);
-                        }
-                    }
-                });
-                rfr->start();
+                constituents.append(c);
             }
         }
+
+        if (!constituents.isEmpty()) {
+            fetchSavedAggregates(constituents);
+        }
+
+        // The manager reports the saved contacts asynchronously, too late for an import
+        // which matches against them immediately
+        if (::localContactIndex.exists()) {
+            ::localContactIndex()->invalidate(savedIds);
+        }
+    } else if (request == &m_removeRequest) {
+        if (::localContactIndex.exists()) {
+            ::localContactIndex()->invalidate(m_removeRequest.contactIds());
+        }
+    }
+
+    if ((request == &m_fetchRequest || request == &m_fetchByIdRequest || request == &m_contactIdRequest ||
+         populateFilter(request) != FilterNone) &&
+        !m_fetchRequest.isActive() && !m_fetchByIdRequest.isActive() && !m_contactIdRequest.isActive() && m_populating == 0) {
+        // Any later write to the database must invalidate a snapshot of the fetched content
+        m_snapshotChangeState = databaseChangeState();
     }
 
     // See if there are any more requests to dispatch
@@ -2891,38 +3517,56 @@ void SeasideCache::addressRequestStateChanged(QContactAbstractRequest::State sta
     QSet<QContactDetail::DetailType> queryDetailTypes = detailTypesHint(request->fetchHint()).toSet();
     applyContactUpdates(request->contacts(), queryDetailTypes);
 
-    // now figure out which address was being resolved and resolve it
-    QHash<QContactFetchRequest *, ResolveData>::iterator it = instancePtr->m_resolveAddresses.find(request);
+    // now figure out which addresses were being resolved and resolve them
+    QHash<QContactFetchRequest *, QList<ResolveData> >::iterator it = instancePtr->m_resolveAddresses.find(request);
     if (it == instancePtr->m_resolveAddresses.end()) {
         qWarning() << "Got stateChanged for unknown request";
         return;
     }
 
-    ResolveData data(it.value());
-    if (data.first == QString()) {
-        // We have now queried this phone number
-        m_resolvedPhoneNumbers.insert(minimizePhoneNumber(data.second));
+    // Listeners may be unregistered by the callbacks, which removes their pending resolutions
+    m_resolvedAddresses = it.value();
+    const int addressCount = m_resolvedAddresses.count();
+    const QList<QContact> resolvedContacts(request->contacts());
+    m_resolveAddresses.erase(it);
+    request->deleteLater();
+
+    // Find the addresses for which the query returned any candidate contact
+    QSet<QString> candidateAddresses;
+    foreach (const QContact &contact, resolvedContacts) {
+        foreach (const QContactPhoneNumber &phoneNumber, contact.details<QContactPhoneNumber>())
+            candidateAddresses.insert(minimizePhoneNumber(phoneNumber.number()));
+        foreach (const QContactEmailAddress &emailAddress, contact.details<QContactEmailAddress>())
+            candidateAddresses.insert(emailAddress.emailAddress().toLower());
+        foreach (const QContactOnlineAccount &account, contact.details<QContactOnlineAccount>())
+            candidateAddresses.insert(account.accountUri().toLower());
     }
 
-    CacheItem *item = 0;
-    const QList<QContact> &resolvedContacts = it.key()->contacts();
+    while (!m_resolvedAddresses.isEmpty()) {
+        ResolveData data(m_resolvedAddresses.takeFirst());
+        if (data.first == QString()) {
+            // We have now queried this phone number
+            m_resolvedPhoneNumbers.insert(minimizePhoneNumber(data.second));
+        }
 
-    if (!resolvedContacts.isEmpty()) {
-        if (resolvedContacts.count() == 1 && data.first != QString()) {
-            // Return the result because it is the only resolved contact; however still filter out false positive phone number matches
-            item = itemById(apiId(resolvedContacts.first()), false);
-        } else {
-            // Lookup the result in our updated indexes
-            if (data.first == QString()) {
-                item = itemByPhoneNumber(data.second, false);
-            } else if (data.second == QString()) {
-                item = itemByEmailAddress(data.first, false);
+        CacheItem *item = 0;
+
+        if (!resolvedContacts.isEmpty()) {
+            if (resolvedContacts.count() == 1 && addressCount == 1 && data.first != QString()) {
+                // Return the result because it is the only resolved contact; however still filter out false positive phone number matches
+                item = itemById(apiId(resolvedContacts.first()), false);
             } else {
-                item = itemByOnlineAccount(data.first, data.second, false);
+                // Lookup the result in our updated indexes
+                if (data.first == QString()) {
+                    item = itemByPhoneNumber(data.second, false);
+                } else if (data.second == QString()) {
+                    item = itemByEmailAddress(data.first, false);
+                } else {
+                    item = itemByOnlineAccount(data.first, data.second, false);
+                }
             }
         }
-    } else {
-        // This address is unknown - keep it for later resolution
+
         if (data.first == QString()) {
             // Compare this phone number in minimized form
             data.compare = minimizePhoneNumber(data.second);
@@ -2934,23 +3578,445 @@ void SeasideCache::addressRequestStateChanged(QContactAbstractRequest::State sta
             data.compare = data.second.toLower();
         }
 
-        m_unknownAddresses.append(data);
+        m_pendingResolve.remove(data);
+
+        if (!item && !candidateAddresses.contains(data.compare)) {
+            // This address is unknown - keep it for later resolution
+            recordUnknownAddress(data);
+        }
+
+        data.listener->addressResolved(data.first, data.second, item);
     }
-    m_pendingResolve.remove(data);
-    data.listener->addressResolved(data.first, data.second, item);
-    delete it.key();
-    m_resolveAddresses.erase(it);
 }
 
 void SeasideCache::makePopulated(FilterType filter)
 {
+    QList<ListModel *> &models = m_models[filter];
+
+    if (m_provisionalFilters & (1 << filter)) {
+        m_provisionalFilters &= ~(1 << filter);
+
+        // The models are already populated from the snapshot; apply any differences
+        // between the restored list and the queried one
+        const FilterType syncFilter = m_syncFilter;
+        m_syncFilter = filter;
+        int cacheIndex = 0;
+        int queryIndex = 0;
+        synchronizeContacts(m_populateIds[filter], cacheIndex, queryIndex);
+        completeSynchronizeList(this, m_contacts[filter], cacheIndex, m_populateIds[filter], queryIndex);
+        m_syncFilter = syncFilter;
+
+        updateSectionBucketIndexCaches(filter);
+
+        m_populateIds[filter].clear();
+
+        for (int i = 0; i < models.count(); ++i)
+            models.at(i)->sourceItemsChanged();
+
+        if (m_populated & (1 << filter))
+            return;
+    }
+
     m_populated |= (1 << filter);
 
-    QList<ListModel *> &models = m_models[filter];
     for (int i = 0; i < models.count(); ++i)
         models.at(i)->makePopulated();
 }
 
+void SeasideCache::populationComplete(FilterType filter)
+{
+    if (filter == FilterFavorites) {
+        makePopulated(FilterFavorites);
+        qDebug() << "Favorites queried in" << m_timer.elapsed() << "ms";
+    } else if (filter == FilterAll) {
+        makePopulated(FilterNone);
+        makePopulated(FilterAll);
+        qDebug() << "All queried in" << m_timer.elapsed() << "ms";
+
+        // All contacts are now loaded
+        m_populateOrder.clear();
+        m_viewportIds.clear();
+        m_viewportGroup.clear();
+    } else if (filter == FilterOnline) {
+        makePopulated(FilterOnline);
+        qDebug() << "Online queried in" << m_timer.elapsed() << "ms";
+    }
+}
+
+void SeasideCache::startPopulateRequest(FilterType filter)
+{
+    QContactFetchRequest &request(m_populateRequests[filter]);
+    if (filter == FilterFavorites) {
+        request.setFilter(favoriteFilter());
+        request.setFetchHint(favoriteFetchHint(m_fetchTypes));
+        request.setSorting(m_sortOrder);
+        qDebug() << "Starting favorites query at" << m_timer.elapsed() << "ms";
+    } else if (filter == FilterAll) {
+        // Request the metadata of all contacts (only data from the primary table, and any
+        // other details required to determine whether the contacts matches the filter)
+        request.setFilter(allFilter());
+        request.setFetchHint(metadataFetchHint(m_fetchTypes));
+        request.setSorting(m_sortOrder);
+        qDebug() << "Starting metadata query at" << m_timer.elapsed() << "ms";
+    } else if (filter == FilterOnline) {
+        // Query for online contacts - fetch the account details, so we know if they're valid
+        request.setFilter(onlineFilter());
+        request.setFetchHint(onlineFetchHint(m_fetchTypes | SeasideCache::FetchAccountUri));
+        request.setSorting(m_onlineSortOrder);
+        qDebug() << "Starting online  query at" << m_timer.elapsed() << "ms";
+    } else {
+        return;
+    }
+
+    request.start();
+}
+
+// Queries the ordered IDs of all contacts, so that the list can be presented to a model
+// reporting its visible range before the content of the list has been loaded
+void SeasideCache::startPopulateIdRequest()
+{
+    if (m_populateIdRequest.state() != QContactAbstractRequest::InactiveState
+            || (m_populated & (1 << FilterAll)) || (m_provisionalFilters & (1 << FilterAll)))
+        return;
+
+    m_populateIdRequest.setFilter(allFilter());
+    m_populateIdRequest.setSorting(m_sortOrder);
+    qDebug() << "Starting ID query at" << m_timer.elapsed() << "ms";
+    m_populateIdRequest.start();
+}
+
+bool SeasideCache::viewportReported() const
+{
+    for (QHash<ListModel *, Viewport>::const_iterator it = m_viewports.constBegin(); it != m_viewports.constEnd(); ++it) {
+        if (m_models[FilterAll].contains(it.key()))
+            return true;
+    }
+    return false;
+}
+
+void SeasideCache::beginViewportPopulation()
+{
+    // Only applicable while the ordered IDs are known but the content is still being loaded
+    if (m_populateOrder.isEmpty() || (m_populated & (1 << FilterAll)) || (m_provisionalFilters & (1 << FilterAll)))
+        return;
+
+    if (!viewportReported())
+        return;
+
+    // Any contacts appended so far are a prefix of the ordered list; present the remainder
+    // as placeholders, and reconcile the list when the metadata query is complete
+    QList<quint32> &cacheIds = m_contacts[FilterAll];
+    m_populateIds[FilterAll] = cacheIds;
+
+    const QSet<quint32> appendedIds(cacheIds.toSet());
+    QList<quint32> placeholderIds;
+    placeholderIds.reserve(m_populateOrder.count() - appendedIds.count());
+    foreach (quint32 iid, m_populateOrder) {
+        if (appendedIds.contains(iid))
+            continue;
+
+        if (!existingItem(iid)) {
+            CacheItem *item = &(m_people[iid]);
+            item->iid = iid;
+            item->contact.setId(apiId(iid));
+        }
+        placeholderIds.append(iid);
+    }
+    m_populateOrder.clear();
+
+    m_provisionalFilters |= (1 << FilterAll);
+
+    if (!placeholderIds.isEmpty()) {
+        QList<ListModel *> &models = m_models[FilterAll];
+
+        const int begin = cacheIds.count();
+        const int end = begin + placeholderIds.count() - 1;
+        for (int i = 0; i < models.count(); ++i)
+            models.at(i)->sourceAboutToInsertItems(begin, end);
+
+        cacheIds.append(placeholderIds);
+
+        for (int i = 0; i < models.count(); ++i)
+            models.at(i)->sourceItemsInserted(begin, end);
+    }
+
+    for (QHash<ListModel *, Viewport>::const_iterator it = m_viewports.constBegin(); it != m_viewports.constEnd(); ++it) {
+        prioritizeViewport(it.key());
+    }
+
+    qDebug() << "Presented" << placeholderIds.count() << "placeholders at" << m_timer.elapsed() << "ms";
+}
+
+void SeasideCache::prioritizeViewport(ListModel *model)
+{
+    // Prefetch rows beyond the visible window, further in the direction of scrolling
+    static const qreal LookaheadSeconds = 0.5;
+    static const int MaxLookahead = 200;
+
+    QHash<ListModel *, Viewport>::const_iterator it = m_viewports.constFind(model);
+    if (it == m_viewports.constEnd() || it->last < it->first)
+        return;
+
+    const QList<quint32> *cacheIds = 0;
+    for (int i = FilterAll; i < FilterTypesCount && !cacheIds; ++i) {
+        if (m_models[i].contains(model))
+            cacheIds = &m_contacts[i];
+    }
+    if (!cacheIds || cacheIds->isEmpty())
+        return;
+
+    const int visibleCount = it->last - it->first + 1;
+    const int lookahead = qMin(qRound(qAbs(it->velocity) * LookaheadSeconds), MaxLookahead);
+
+    const int first = qBound(0, it->first, cacheIds->count() - 1);
+    const int last = qBound(0, it->last, cacheIds->count() - 1);
+    const int begin = qMax(0, first - (visibleCount / 2) - (it->velocity < 0 ? lookahead : 0));
+    const int end = qMin(cacheIds->count() - 1, last + (visibleCount / 2) + (it->velocity > 0 ? lookahead : 0));
+
+    // Fetch the visible rows first, then those we are moving towards
+    QList<quint32> ids;
+    auto addIndex = [cacheIds, &ids](int index) {
+        const quint32 iid = cacheIds->at(index);
+        const CacheItem *item = existingItem(iid);
+        if (item && item->contactState == ContactAbsent)
+            ids.append(iid);
+    };
+    for (int i = first; i <= last; ++i)
+        addIndex(i);
+    if (it->velocity < 0) {
+        for (int i = first - 1; i >= begin; --i)
+            addIndex(i);
+        for (int i = last + 1; i <= end; ++i)
+            addIndex(i);
+    } else {
+        for (int i = last + 1; i <= end; ++i)
+            addIndex(i);
+        for (int i = first - 1; i >= begin; --i)
+            addIndex(i);
+    }
+
+    // Any previously reported window is no longer of interest
+    m_viewportIds = ids;
+    if (!m_viewportIds.isEmpty()) {
+        requestUpdate();
+    }
+}
+
+void SeasideCache::startViewportFetch()
+{
+    static const int MaxViewportFetch = 100;
+    static const int MaxGroupFetch = 50;
+
+    QContactFetchHint fetchHint(metadataFetchHint(m_fetchTypes));
+
+    QList<QContactId> ids;
+    while (!m_viewportIds.isEmpty() && ids.count() < MaxViewportFetch) {
+        // Skip any contacts that have been loaded since they were reported
+        const quint32 iid = m_viewportIds.takeFirst();
+        const CacheItem *item = existingItem(iid);
+        if (item && item->contactState == ContactAbsent)
+            ids.append(apiId(iid));
+    }
+
+    if (!ids.isEmpty()) {
+        QContactIdFilter filter;
+        filter.setIds(ids);
+
+        m_viewportFetchRequest.setFilter(filter & aggregateFilter());
+        m_viewportFetchRequest.setSorting(QList<QContactSortOrder>());
+    } else if (!m_viewportGroup.isEmpty()) {
+        // Load the start of the group, so that the model can locate its section
+        QContactDetailFilter filter;
+        setDetailType<QContactDisplayLabel>(filter, QContactDisplayLabel__FieldLabelGroup);
+        filter.setValue(m_viewportGroup);
+        filter.setMatchFlags(QContactFilter::MatchExactly);
+        m_viewportGroup.clear();
+
+        fetchHint.setMaxCountHint(MaxGroupFetch);
+
+        m_viewportFetchRequest.setFilter(filter & allFilter());
+        m_viewportFetchRequest.setSorting(m_sortOrder);
+    } else {
+        return;
+    }
+
+    m_viewportFetchRequest.setFetchHint(fetchHint);
+    m_viewportFetchRequest.start();
+
+    m_viewportFetchProcessedCount = 0;
+}
+
+SeasideCache::FilterType SeasideCache::populateFilter(const QContactAbstractRequest *request) const
+{
+    for (int i = FilterAll; i < FilterTypesCount; ++i) {
+        if (request == &m_populateRequests[i])
+            return static_cast<FilterType>(i);
+    }
+    return FilterNone;
+}
+
+void SeasideCache::loadSnapshot()
+{
+    const QString path(snapshotPath());
+    if (path.isEmpty() || !m_people.isEmpty())
+        return;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    const qint64 size = file.size();
+    uchar *mapped = size > 0 ? file.map(0, size) : 0;
+    if (!mapped) {
+        qWarning() << "Unable to map cache snapshot:" << path;
+        return;
+    }
+
+    QList<SnapshotItem> items;
+    QList<quint32> lists[FilterTypesCount];
+    bool swapLabels = false;
+    bool valid = false;
+    {
+        // Read directly from the mapped pages rather than copying the file content
+        const QByteArray data(QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), size));
+        QDataStream stream(data);
+        stream.setVersion(QDataStream::Qt_5_0);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        QByteArray changeState;
+        quint32 fetchTypes = 0;
+        qint32 labelOrder = 0;
+        QString property;
+        stream >> magic >> version;
+        if (magic == snapshotMagic && version == snapshotVersion) {
+            stream >> changeState >> fetchTypes >> labelOrder >> property;
+        }
+
+        // Only use the snapshot if nothing has been written to the database since it was stored,
+        // and it holds the same details that our models require
+        if (stream.status() == QDataStream::Ok && !changeState.isEmpty() &&
+            changeState == databaseChangeState() && fetchTypes == m_fetchTypes && property == sortProperty()) {
+            // Labels stored in the other order are swapped as they are restored
+            swapLabels = (labelOrder != displayLabelOrder());
+
+            quint32 count = 0;
+            stream >> count;
+            for ( ; count > 0 && stream.status() == QDataStream::Ok; --count) {
+                SnapshotItem item;
+                stream >> item;
+                items.append(item);
+            }
+
+            stream >> lists[FilterFavorites] >> lists[FilterAll] >> lists[FilterOnline];
+            valid = (stream.status() == QDataStream::Ok);
+        }
+    }
+    file.unmap(mapped);
+
+    if (!valid)
+        return;
+
+    foreach (const SnapshotItem &snapshot, items) {
+        CacheItem *item = &(m_people[snapshot.iid]);
+        item->iid = snapshot.iid;
+        item->contact = snapshotContact(snapshot);
+        item->contactState = ContactPartial;
+        item->statusFlags = snapshot.statusFlags;
+        item->displayLabel = swapLabels ? snapshot.alternateDisplayLabel : snapshot.displayLabel;
+        m_alternateDisplayLabels.insert(item->iid, swapLabels ? snapshot.displayLabel : snapshot.alternateDisplayLabel);
+        item->displayLabelGroup = snapshot.displayLabelGroup;
+
+        updateContactIndexing(QContact(), item->contact, item->iid, QSet<QContactDetail::DetailType>(), item);
+        updateSearchIndexing(item);
+    }
+
+    QSet<QString> modifiedGroups;
+
+    for (int filter = FilterAll; filter < FilterTypesCount; ++filter) {
+        QList<quint32> &cacheIds = m_contacts[filter];
+        foreach (quint32 iid, lists[filter]) {
+            if (m_people.contains(iid))
+                cacheIds.append(iid);
+        }
+
+        if (filter == FilterAll) {
+            foreach (quint32 iid, cacheIds) {
+                addToContactDisplayLabelGroup(iid, m_people.find(iid)->displayLabelGroup, &modifiedGroups);
+            }
+        }
+
+        if (!cacheIds.isEmpty()) {
+            QList<ListModel *> &models = m_models[filter];
+            for (int i = 0; i < models.count(); ++i)
+                models.at(i)->sourceAboutToInsertItems(0, cacheIds.count() - 1);
+            for (int i = 0; i < models.count(); ++i)
+                models.at(i)->sourceItemsInserted(0, cacheIds.count() - 1);
+        }
+    }
+
+    notifyDisplayLabelGroupsChanged(modifiedGroups);
+
+    for (int filter = FilterNone; filter < FilterTypesCount; ++filter) {
+        makePopulated(static_cast<FilterType>(filter));
+        m_provisionalFilters |= (1 << filter);
+    }
+
+    updateSectionBucketIndexCaches();
+    qDebug() << "Restored" << items.count() << "contacts from snapshot at" << m_timer.elapsed() << "ms";
+}
+
+void SeasideCache::saveSnapshot()
+{
+    if (m_populateProgress != Populated || m_provisionalFilters || m_syncFilter != FilterNone || m_refreshRequired ||
+        !m_changedContacts.isEmpty() || !m_contactsToAppend.isEmpty() || !m_contactsToUpdate.isEmpty()) {
+        // Only record a settled state; we will try again when processing is idle
+        return;
+    }
+
+    // The database state was recorded when the content of the cache was last fetched
+    const QString path(snapshotPath());
+    if (path.isEmpty() || m_snapshotChangeState.isEmpty())
+        return;
+
+    if (!QDir().mkpath(QFileInfo(path).path())) {
+        qWarning() << "Unable to create cache snapshot directory:" << path;
+        return;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Unable to write cache snapshot:" << path;
+        return;
+    }
+
+    // Every listed contact is also present in the FilterAll list
+    QList<const CacheItem *> items;
+    foreach (quint32 iid, m_contacts[FilterAll]) {
+        const CacheItem *item = m_people.find(iid);
+        if (item && item->contactState != ContactAbsent)
+            items.append(item);
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << snapshotMagic << snapshotVersion << m_snapshotChangeState << m_fetchTypes
+           << static_cast<qint32>(displayLabelOrder()) << sortProperty();
+
+    stream << static_cast<quint32>(items.count());
+    foreach (const CacheItem *item, items) {
+        stream << snapshotItem(*item, m_alternateDisplayLabels.value(item->iid));
+    }
+    stream << m_contacts[FilterFavorites] << m_contacts[FilterAll] << m_contacts[FilterOnline];
+
+    if (!file.commit()) {
+        qWarning() << "Unable to commit cache snapshot:" << path;
+        return;
+    }
+
+    m_snapshotDirty = false;
+}
+
 void SeasideCache::setSortOrder(const QString &property)
 {
     bool firstNameFirst = (property == QString::fromLatin1("firstName"));
@@ -2984,30 +4050,102 @@ void SeasideCache::setSortOrder(const QString &property)
 
 void SeasideCache::displayLabelOrderChanged(CacheConfiguration::DisplayLabelOrder order)
 {
-    // Update the display labels
-    typedef QHash<quint32, CacheItem>::iterator iterator;
-    for (iterator it = m_people.begin(); it != m_people.end(); ++it) {
-        // Regenerate the display label
-        QString newLabel = generateDisplayLabel(it->contact, static_cast<DisplayLabelOrder>(order));
-        if (newLabel != it->displayLabel) {
-            it->displayLabel = newLabel;
+    Q_UNUSED(order)
 
-            contactDataChanged(it->iid);
-            reportItemUpdated(&*it);
-        }
+    // Each item holds its label in both orders, so changing the order only swaps them; the
+    // items affected are re-indexed and reported over several frames, since there may be many of them
+    m_labelOrderItems.clear();
 
-        if (it->itemData) {
-            it->itemData->displayLabelOrderChanged(static_cast<DisplayLabelOrder>(order));
+    typedef CacheItemStore<CacheItem>::iterator iterator;
+    for (iterator it = m_people.begin(); it != m_people.end(); ++it) {
+        bool changed = false;
+        QHash<quint32, QString>::iterator alternate = m_alternateDisplayLabels.find(it->iid);
+        if (alternate != m_alternateDisplayLabels.end()) {
+            it->displayLabel.swap(*alternate);
+            changed = (it->displayLabel != *alternate);
+        }
+        if (it->itemData || changed) {
+            m_labelOrderItems.append(it->iid);
         }
     }
 
     for (int i = 0; i < FilterTypesCount; ++i) {
+        m_labelOrderRows[i] = 0;
+
         const QList<ListModel *> &models = m_models[i];
         for (int j = 0; j < models.count(); ++j) {
-            ListModel *model = models.at(j);
-            model->updateDisplayLabelOrder();
-            model->sourceItemsChanged();
+            models.at(j)->updateDisplayLabelOrder();
+        }
+    }
+
+    reportDisplayLabelOrderChanges();
+}
+
+// Rows from 'row' onwards have changed position; any whose label order change was already
+// reported must be scanned again
+void SeasideCache::labelOrderRowsChanged(FilterType filter, int row)
+{
+    m_labelOrderRows[filter] = qMin(m_labelOrderRows[filter], row);
+}
+
+void SeasideCache::reportDisplayLabelOrderChanges()
+{
+    // Reporting yields after a slice of each frame, so that the changes can be displayed as they are made
+    static const int LabelOrderFrameMs = 16;
+    static const int LabelOrderSliceMs = 4;
+
+    QElapsedTimer sliceTimer;
+    sliceTimer.start();
+
+    // Report the items to their listeners first, so that model data reflects the change
+    const DisplayLabelOrder order(displayLabelOrder());
+    while (!m_labelOrderItems.isEmpty() && !sliceTimer.hasExpired(LabelOrderSliceMs)) {
+        if (CacheItem *item = existingItem(m_labelOrderItems.takeFirst())) {
+            if (item->displayLabel != m_alternateDisplayLabels.value(item->iid)) {
+                // The search indexes hold the tokens of the label in its previous order
+                updateSearchIndexing(item);
+                reportItemUpdated(item);
+            }
+            if (item->itemData) {
+                item->itemData->displayLabelOrderChanged(order);
+            }
+        }
+    }
+
+    // Then report the rows of each model, with a single notification for each range of changed rows
+    bool complete = m_labelOrderItems.isEmpty();
+    for (int i = 0; i < FilterTypesCount; ++i) {
+        const QList<quint32> &cacheIds(m_contacts[i]);
+        const QList<ListModel *> &models(m_models[i]);
+        int &row(m_labelOrderRows[i]);
+
+        if (models.isEmpty()) {
+            row = cacheIds.count();
+        }
+        while (complete && row < cacheIds.count() && !sliceTimer.hasExpired(LabelOrderSliceMs)) {
+            const int begin = row;
+            for ( ; row < cacheIds.count(); ++row) {
+                const CacheItem *item = existingItem(cacheIds.at(row));
+                if (!item || item->displayLabel == m_alternateDisplayLabels.value(item->iid))
+                    break;
+            }
+
+            if (row > begin) {
+                for (int j = 0; j < models.count(); ++j) {
+                    models.at(j)->sourceDataChanged(begin, row - 1);
+                }
+            } else {
+                ++row;
+            }
         }
+
+        complete &= (row >= cacheIds.count());
+    }
+
+    if (complete) {
+        m_labelOrderTimer.stop();
+    } else if (!m_labelOrderTimer.isActive()) {
+        m_labelOrderTimer.start(LabelOrderFrameMs, this);
     }
 }
 
@@ -3029,9 +4167,122 @@ void SeasideCache::sortPropertyChanged(const QString &sortProperty)
         }
     }
 
-    // Update the sorted list order
-    m_refreshRequired = true;
-    requestUpdate();
+    // Reorder the lists from the cached names if possible, otherwise query the new order
+    if (!sortContactsLocally()) {
+        m_refreshRequired = true;
+        requestUpdate();
+    }
+}
+
+bool SeasideCache::sortContactsLocally()
+{
+    if (m_populateProgress != Populated || m_provisionalFilters || m_syncFilter != FilterNone || !m_contactsToAppend.isEmpty())
+        return false;
+
+    struct SortItem {
+        quint32 iid;
+        int presence;
+        int group;
+        QString names[2]; // first name then last name, as compared by the backend
+    };
+
+    // Display label groups are ordered as they are listed, followed by any unknown groups
+    QHash<QString, int> groupOrder;
+    for (int i = 0; i < allContactDisplayLabelGroups.count(); ++i) {
+        groupOrder.insert(allContactDisplayLabelGroups.at(i), i);
+    }
+
+    QVector<SortItem> items[FilterTypesCount];
+    for (int filter = FilterAll; filter < FilterTypesCount; ++filter) {
+        const QList<quint32> &cacheIds(m_contacts[filter]);
+        items[filter].reserve(cacheIds.count());
+
+        foreach (quint32 iid, cacheIds) {
+            const CacheItem *item = existingItem(iid);
+            if (!item || item->contactState == ContactAbsent) {
+                // We can only sort contacts whose names are known
+                return false;
+            }
+
+            // qtcontacts-sqlite orders case-insensitive fields by their lower-cased values,
+            // with its locale collation; comparing the same way yields the order the next
+            // query returns, so the list is not rearranged again when it is refreshed
+            const QContactName name(item->contact.detail<QContactName>());
+            const SortItem sortItem = {
+                iid,
+                (filter == FilterOnline) ? static_cast<int>(item->contact.detail<QContactGlobalPresence>().presenceState()) : 0,
+                groupOrder.value(item->displayLabelGroup, groupOrder.count()),
+                { name.firstName().toLower(), name.lastName().toLower() }
+            };
+            items[filter].append(sortItem);
+        }
+    }
+
+    // Match the ordering of m_sortOrder and m_onlineSortOrder
+    const int primary = (sortProperty() == QString::fromLatin1("firstName")) ? 0 : 1;
+    const int secondary = 1 - primary;
+
+    for (int filter = FilterAll; filter < FilterTypesCount; ++filter) {
+        QVector<SortItem> &sortItems(items[filter]);
+        std::sort(sortItems.begin(), sortItems.end(), [primary, secondary](const SortItem &lhs, const SortItem &rhs) {
+            if (lhs.presence != rhs.presence)
+                return lhs.presence < rhs.presence;
+            if (lhs.group != rhs.group)
+                return lhs.group < rhs.group;
+            if (int rv = QString::localeAwareCompare(lhs.names[primary], rhs.names[primary]))
+                return rv < 0;
+            if (int rv = QString::localeAwareCompare(lhs.names[secondary], rhs.names[secondary]))
+                return rv < 0;
+            return lhs.iid < rhs.iid;
+        });
+
+        QList<quint32> sortedIds;
+        sortedIds.reserve(sortItems.count());
+        foreach (const SortItem &sortItem, sortItems) {
+            sortedIds.append(sortItem.iid);
+        }
+
+        QList<quint32> &cacheIds(m_contacts[filter]);
+        if (sortedIds == cacheIds)
+            continue;
+
+        // Models which cannot be reset are informed of the removal and reinsertion of every item
+        const QList<ListModel *> &models = m_models[filter];
+        const int count = cacheIds.count();
+        for (int i = 0; i < models.count(); ++i) {
+            if (handlesSourceResets(models.at(i))) {
+                invokeModelMethod(models.at(i), aboutToResetItemsSignature);
+            } else if (count > 0) {
+                models.at(i)->sourceAboutToRemoveItems(0, count - 1);
+            }
+        }
+
+        cacheIds.clear();
+
+        for (int i = 0; i < models.count(); ++i) {
+            if (!handlesSourceResets(models.at(i)) && count > 0) {
+                models.at(i)->sourceItemsRemoved();
+                models.at(i)->sourceAboutToInsertItems(0, count - 1);
+            }
+        }
+
+        cacheIds = sortedIds;
+        labelOrderRowsChanged(static_cast<FilterType>(filter), 0);
+
+        for (int i = 0; i < models.count(); ++i) {
+            if (handlesSourceResets(models.at(i))) {
+                invokeModelMethod(models.at(i), itemsResetSignature);
+            } else if (count > 0) {
+                models.at(i)->sourceItemsInserted(0, count - 1);
+            }
+            models.at(i)->sourceItemsChanged();
+        }
+
+        updateSectionBucketIndexCaches(static_cast<FilterType>(filter));
+    }
+
+    m_snapshotDirty = true;
+    return true;
 }
 
 void SeasideCache::displayStatusChanged(const QString &status)
@@ -3055,7 +4306,7 @@ int SeasideCache::importContacts(const QString &path)
         return 0;
     }
 
-    // TODO: thread
+    // This blocks until the whole file has been read; startImport() reads it in the background
     QVersitReader reader(&vcf);
     reader.startReading();
     reader.waitForFinished();
@@ -3071,6 +4322,26 @@ int SeasideCache::importContacts(const QString &path)
     return newContacts.count();
 }
 
+SeasideImportJob *SeasideCache::startImport(const QString &path)
+{
+    instance();
+
+    instancePtr->m_expiryTimer.stop();
+
+    SeasideImportJob *job = new SeasideImportJob(path, instancePtr);
+    connect(job, &SeasideImportJob::contactsAvailable, instancePtr, &SeasideCache::requestUpdate);
+    connect(job, &SeasideImportJob::finished, instancePtr, [job] {
+        instancePtr->m_importJobs.removeAll(job);
+        job->deleteLater();
+        checkForExpiry();
+    });
+
+    instancePtr->m_importJobs.append(job);
+    job->start();
+
+    return job;
+}
+
 QString SeasideCache::exportContacts()
 {
     QVersitContactExporter exporter;
@@ -3083,7 +4354,7 @@ QString SeasideCache::exportContacts()
 
     const quint32 selfId = internalId(manager()->selfContactId());
 
-    typedef QHash<quint32, CacheItem>::iterator iterator;
+    typedef CacheItemStore<CacheItem>::iterator iterator;
     for (iterator it = instancePtr->m_people.begin(); it != instancePtr->m_people.end(); ++it) {
         if (it.key() == selfId) {
             continue;
@@ -3104,15 +4375,7 @@ QString SeasideCache::exportContacts()
         return QString();
     }
 
-    QString baseDir;
-    foreach (const QString &loc, QStandardPaths::standardLocations(QStandardPaths::DocumentsLocation)) {
-        baseDir = loc;
-        break;
-    }
-    QFile vcard(baseDir
-              + QDir::separator()
-              + QLocale::c().toString(QDateTime::currentDateTime(), QStringLiteral("ss_mm_hh_dd_mm_yyyy"))
-              + ".vcf");
+    QFile vcard(exportFilePath());
 
     if (!vcard.open(QIODevice::WriteOnly)) {
         qWarning() << "Cannot open " << vcard.fileName();
@@ -3125,11 +4388,32 @@ QString SeasideCache::exportContacts()
         return QString();
     }
 
-    // TODO: thread
+    // This blocks until the file has been written; startExport() writes it in the background
     writer.waitForFinished();
     return vcard.fileName();
 }
 
+SeasideExportJob *SeasideCache::startExport()
+{
+    instance();
+
+    instancePtr->m_expiryTimer.stop();
+
+    // Export every contact, including those which have not been loaded into the cache; the
+    // job queries their ids itself, so that this thread is not blocked
+    SeasideExportJob *job = new SeasideExportJob(manager(), allFilter(), instancePtr->m_sortOrder, exportFilePath(), instancePtr);
+    connect(job, &SeasideExportJob::finished, instancePtr, [job] {
+        instancePtr->m_exportJobs.removeAll(job);
+        job->deleteLater();
+        checkForExpiry();
+    });
+
+    instancePtr->m_exportJobs.append(job);
+    job->start();
+
+    return job;
+}
+
 void SeasideCache::keepPopulated(quint32 requiredTypes, quint32 extraTypes)
 {
     bool updateRequired(false);
@@ -3156,6 +4440,14 @@ void SeasideCache::keepPopulated(quint32 requiredTypes, quint32 extraTypes)
     if (!m_keepPopulated) {
         m_keepPopulated = true;
         updateRequired = true;
+
+        // Populated models may be searched, so index the contacts as they are loaded
+        ensureSearchIndexing();
+
+        // Present the previously cached state while the population queries run
+        if (m_populateProgress == Unpopulated) {
+            loadSnapshot();
+        }
     }
 
     if (updateRequired) {
@@ -3265,6 +4557,78 @@ void SeasideCache::completeContactAggregation(const QContactId &contact1Id, cons
         requestUpdate();
 }
 
+bool SeasideCache::isKnownUnknownAddress(const QString &first, const QString &second)
+{
+    // Addresses may become known without our being informed, if the contact is not cached
+    static const qint64 UnknownAddressExpiryMs = 10 * 60 * 1000;
+
+    QHash<QString, UnknownAddress>::iterator it = m_unknownAddresses.find(unknownAddressKey(first, second));
+    if (it == m_unknownAddresses.end()) {
+        ++m_unknownAddressMisses;
+        return false;
+    }
+
+    m_unknownAddressUse.remove(it->sequence);
+    it->sequence = ++m_unknownAddressSequence;
+    m_unknownAddressUse.insert(it->sequence, it.key());
+
+    if (it->recorded < 0 || m_timer.elapsed() - it->recorded > UnknownAddressExpiryMs) {
+        // Query the address again, but keep the entry so that its listeners are still
+        // informed if the address becomes known
+        it->recorded = -1;
+        ++m_unknownAddressMisses;
+        return false;
+    }
+
+    ++m_unknownAddressHits;
+    return true;
+}
+
+QContactFilter SeasideCache::resolveFilter(const QString &first, const QString &second)
+{
+    if (first.isEmpty()) {
+        // Search for phone number
+        return QContactPhoneNumber::match(second);
+    } else if (second.isEmpty()) {
+        // Search for email address
+        QContactDetailFilter detailFilter;
+        setDetailType<QContactEmailAddress>(detailFilter, QContactEmailAddress::FieldEmailAddress);
+        detailFilter.setMatchFlags(QContactFilter::MatchExactly | QContactFilter::MatchFixedString); // allow case insensitive
+        detailFilter.setValue(first);
+
+        return detailFilter;
+    }
+
+    // Search for online account
+    QContactDetailFilter localFilter;
+    setDetailType<QContactOnlineAccount>(localFilter, QContactOnlineAccount__FieldAccountPath);
+    localFilter.setValue(first);
+
+    QContactDetailFilter remoteFilter;
+    setDetailType<QContactOnlineAccount>(remoteFilter, QContactOnlineAccount::FieldAccountUri);
+    remoteFilter.setMatchFlags(QContactFilter::MatchExactly | QContactFilter::MatchFixedString); // allow case insensitive
+    remoteFilter.setValue(second);
+
+    return localFilter & remoteFilter;
+}
+
+void SeasideCache::startResolveRequest(const QContactFilter &filter, const QList<ResolveData> &addresses, bool requireComplete)
+{
+    QContactFetchRequest *request = new QContactFetchRequest(this);
+    request->setManager(manager());
+    request->setFilter(filter);
+
+    // If completion is not required, at least include the contact endpoint details (since resolving is obviously being used)
+    const quint32 detailFetchTypes(SeasideCache::FetchAccountUri | SeasideCache::FetchPhoneNumber | SeasideCache::FetchEmailAddress);
+    request->setFetchHint(requireComplete ? basicFetchHint() : onlineFetchHint(m_fetchTypes | m_extraFetchTypes | detailFetchTypes));
+    connect(request, SIGNAL(stateChanged(QContactAbstractRequest::State)),
+        this, SLOT(addressRequestStateChanged(QContactAbstractRequest::State)));
+    m_resolveAddresses[request] = addresses;
+    foreach (const ResolveData &data, addresses)
+        m_pendingResolve.insert(data);
+    request->start();
+}
+
 void SeasideCache::resolveAddress(ResolveListener *listener, const QString &first, const QString &second, bool requireComplete)
 {
     ResolveData data;
@@ -3278,121 +4642,86 @@ void SeasideCache::resolveAddress(ResolveListener *listener, const QString &firs
         return;
 
     // Is this address a known-unknown?
-    bool knownUnknown = false;
-    QList<ResolveData>::const_iterator it = instancePtr->m_unknownAddresses.constBegin(), end = m_unknownAddresses.constEnd();
-    for ( ; it != end; ++it) {
-        if (it->first == first && it->second == second) {
-            knownUnknown = true;
-            break;
-        }
-    }
-
-    if (knownUnknown) {
+    if (isKnownUnknownAddress(first, second)) {
         m_unknownResolveAddresses.append(data);
         requestUpdate();
     } else {
-        QContactFetchRequest *request = new QContactFetchRequest(this);
-        request->setManager(manager());
-
-        if (first.isEmpty()) {
-            // Search for phone number
-            request->setFilter(QContactPhoneNumber::match(second));
-        } else if (second.isEmpty()) {
-            // Search for email address
-            QContactDetailFilter detailFilter;
-            setDetailType<QContactEmailAddress>(detailFilter, QContactEmailAddress::FieldEmailAddress);
-            detailFilter.setMatchFlags(QContactFilter::MatchExactly | QContactFilter::MatchFixedString); // allow case insensitive
-            detailFilter.setValue(first);
-
-            request->setFilter(detailFilter);
-        } else {
-            // Search for online account
-            QContactDetailFilter localFilter;
-            setDetailType<QContactOnlineAccount>(localFilter, QContactOnlineAccount__FieldAccountPath);
-            localFilter.setValue(first);
-
-            QContactDetailFilter remoteFilter;
-            setDetailType<QContactOnlineAccount>(remoteFilter, QContactOnlineAccount::FieldAccountUri);
-            remoteFilter.setMatchFlags(QContactFilter::MatchExactly | QContactFilter::MatchFixedString); // allow case insensitive
-            remoteFilter.setValue(second);
-
-            request->setFilter(localFilter & remoteFilter);
-        }
-
-        // If completion is not required, at least include the contact endpoint details (since resolving is obviously being used)
-        const quint32 detailFetchTypes(SeasideCache::FetchAccountUri | SeasideCache::FetchPhoneNumber | SeasideCache::FetchEmailAddress);
-        request->setFetchHint(requireComplete ? basicFetchHint() : onlineFetchHint(m_fetchTypes | m_extraFetchTypes | detailFetchTypes));
-        connect(request, SIGNAL(stateChanged(QContactAbstractRequest::State)),
-            this, SLOT(addressRequestStateChanged(QContactAbstractRequest::State)));
-        m_resolveAddresses[request] = data;
-        m_pendingResolve.insert(data);
-        request->start();
+        startResolveRequest(resolveFilter(first, second), QList<ResolveData>() << data, requireComplete);
     }
 }
 
-SeasideCache::CacheItem *SeasideCache::itemMatchingPhoneNumber(const QString &number, const QString &normalized, bool requireComplete)
+void SeasideCache::resolveBatchAddresses()
 {
-    QMultiHash<QString, CachedPhoneNumber>::const_iterator it = m_phoneNumberIds.find(number), end = m_phoneNumberIds.constEnd();
-    if (it == end)
-        return 0;
+    // Each query must remain within the bound variable limit of the database
+    static const int MaxPhoneNumbersPerQuery = 100;
+    static const int MaxEmailAddressesPerQuery = 200;
 
-    QHash<QString, quint32> possibleMatches;
-    ::i18n::phonenumbers::PhoneNumberUtil *util = ::i18n::phonenumbers::PhoneNumberUtil::GetInstance();
-    ::std::string normalizedStdStr = normalized.toStdString();
+    // Queries are grouped by address type and the fetch hint required
+    enum { PhoneNumbers, EmailAddresses, GroupCount };
+    QList<ResolveData> groups[GroupCount][2];
 
-    for (QMultiHash<QString, CachedPhoneNumber>::const_iterator matchingIt = it;
-         matchingIt != end && matchingIt.key() == number;
-         ++matchingIt) {
+    // Listeners may be unregistered by the callbacks, which removes their pending resolutions
+    QSet<ResolveData> batched;
+    while (!m_batchResolveAddresses.isEmpty()) {
+        const ResolveData data(m_batchResolveAddresses.takeFirst());
+        const bool phoneNumber = data.first.isEmpty();
+        CacheItem *item = phoneNumber ? itemByPhoneNumber(data.second, data.requireComplete)
+                                      : itemByEmailAddress(data.first, data.requireComplete);
+        if (item) {
+            if (data.requireComplete) {
+                ensureCompletion(item);
+            }
+            data.listener->addressResolved(data.first, data.second, item);
+        } else if (m_pendingResolve.contains(data) || batched.contains(data)) {
+            // Already being resolved
+        } else if (isKnownUnknownAddress(data.first, data.second)) {
+            m_unknownResolveAddresses.append(data);
+        } else {
+            groups[phoneNumber ? PhoneNumbers : EmailAddresses][data.requireComplete ? 1 : 0].append(data);
+            batched.insert(data);
+        }
+    }
 
-        const CachedPhoneNumber &cachedPhoneNumber = matchingIt.value();
+    for (int type = 0; type < GroupCount; ++type) {
+        const int chunkSize = (type == PhoneNumbers) ? MaxPhoneNumbersPerQuery : MaxEmailAddressesPerQuery;
 
-        // Bypass libphonenumber if the numbers match exactly
-        if (matchingIt->normalizedNumber == normalized)
-            return itemById(cachedPhoneNumber.iid, requireComplete);
+        for (int complete = 0; complete < 2; ++complete) {
+            const QList<ResolveData> &group(groups[type][complete]);
 
-        ::i18n::phonenumbers::PhoneNumberUtil::MatchType matchType =
-                util->IsNumberMatchWithTwoStrings(normalizedStdStr, cachedPhoneNumber.normalizedNumber.toStdString());
+            for (int i = 0; i < group.count(); i += chunkSize) {
+                const QList<ResolveData> chunk(group.mid(i, chunkSize));
 
-        switch (matchType) {
-        case ::i18n::phonenumbers::PhoneNumberUtil::EXACT_MATCH:
-            // This is the optimal outcome
-            return itemById(cachedPhoneNumber.iid, requireComplete);
-        case ::i18n::phonenumbers::PhoneNumberUtil::NSN_MATCH:
-        case ::i18n::phonenumbers::PhoneNumberUtil::SHORT_NSN_MATCH:
-            // Store numbers whose NSN (national significant number) might match
-            // Example: if +36701234567 is calling, then 1234567 is an NSN match
-            possibleMatches.insert(cachedPhoneNumber.normalizedNumber, cachedPhoneNumber.iid);
-            break;
-        default:
-            // Either couldn't parse the number or it was NO_MATCH, ignore it
-            break;
-        }
-    }
+                // Addresses requested by multiple listeners are only queried once
+                QContactUnionFilter filter;
+                QSet<QString> queried;
+                foreach (const ResolveData &data, chunk) {
+                    const QString &address(type == PhoneNumbers ? data.second : data.first);
+                    if (!queried.contains(address)) {
+                        queried.insert(address);
+                        filter.append(resolveFilter(data.first, data.second));
+                    }
+                }
 
-    // Choose the best match from these contacts
-    int bestMatchLength = 0;
-    CacheItem *matchItem = 0;
-    for (QHash<QString, quint32>::const_iterator matchingIt = possibleMatches.begin(); matchingIt != possibleMatches.end(); ++matchingIt) {
-        if (CacheItem *item = existingItem(*matchingIt)) {
-            int matchLength = bestPhoneNumberMatchLength(item->contact, normalized);
-            if (matchLength > bestMatchLength) {
-                bestMatchLength = matchLength;
-                matchItem = item;
-                if (bestMatchLength == ExactMatch)
-                    break;
+                startResolveRequest(filter, chunk, complete != 0);
             }
         }
     }
+}
 
-    if (matchItem != 0) {
-        if (requireComplete) {
-            ensureCompletion(matchItem);
-        }
-        return matchItem;
-    }
+SeasideCache::CacheItem *SeasideCache::itemMatchingPhoneNumber(const QString &number, const QString &normalized, bool requireComplete)
+{
+    const SeasidePhoneNumberIndex::Match match(m_phoneNumberIndex.find(number, normalized));
+    if (match.iid == 0)
+        return 0;
 
-    return 0;
+    if (match.exact)
+        return itemById(match.iid, requireComplete);
 
+    CacheItem *matchItem = existingItem(match.iid);
+    if (matchItem && requireComplete) {
+        ensureCompletion(matchItem);
+    }
+    return matchItem;
 }
 
 int SeasideCache::contactIndex(quint32 iid, FilterType filterType)
@@ -34,6 +34,13 @@
 
 #include "contactcacheexport.h"
 #include "cacheconfiguration.h"
+#include "cacheitemstore.h"
+#include "seasidedialpadindex.h"
+#include "seasideexportjob.h"
+#include "seasideimportjob.h"
+#include "seasidelocalcontactindex.h"
+#include "seasidephonenumberindex.h"
+#include "seasidesearchindex.h"
 
 #include <qtcontacts-extensions.h>
 #include <QContactStatusFlags>
@@ -54,7 +61,10 @@
 #include <QTranslator>
 #include <QBasicTimer>
 #include <QHash>
+#include <QMap>
+#include <QPointer>
 #include <QSet>
+#include <QVector>
 
 #include <QElapsedTimer>
 #include <QAbstractListModel>
@@ -247,6 +257,15 @@ public:
 
         virtual void sourceItemsChanged() = 0;
 
+        // When the order of the source list changes entirely, a model declaring the invokable
+        // methods sourceAboutToResetItems() and sourceItemsReset() is reset; others are informed
+        // of the removal of every item followed by the insertion of the reordered list
+
+        // Items which change position are reported as moves only if every model of the filter
+        // declares the invokable methods sourceAboutToMoveItems(int begin, int end, int destination)
+        // and sourceItemsMoved(), with the semantics of beginMoveRows() and endMoveRows();
+        // otherwise they are reported as removals followed by insertions
+
         virtual void makePopulated() = 0;
         virtual void updateDisplayLabelOrder() = 0;
         virtual void updateSortProperty() = 0;
@@ -274,6 +293,8 @@ public:
 
     static SeasideCache *instance();
     static QContactManager *manager();
+    static bool isManager(const QContactManager *manager);
+    static SeasideLocalContactIndex *localContactIndex();
 
     static QContactId apiId(const QContact &contact);
     static QContactId apiId(quint32 iid);
@@ -286,6 +307,9 @@ public:
     static void registerModel(ListModel *model, FilterType type, FetchDataType requiredTypes = FetchNone, FetchDataType extraTypes = FetchNone);
     static void unregisterModel(ListModel *model);
 
+    static void reportVisibleRange(ListModel *model, int first, int last, qreal velocity = 0);
+    static void reportVisibleDisplayLabelGroup(ListModel *model, const QString &group);
+
     static void registerUser(QObject *user);
     static void unregisterUser(QObject *user);
 
@@ -326,6 +350,12 @@ public:
     static CacheItem *resolveEmailAddress(ResolveListener *listener, const QString &address, bool requireComplete = true);
     static CacheItem *resolveOnlineAccount(ResolveListener *listener, const QString &localUid, const QString &remoteUid, bool requireComplete = true);
 
+    static void resolvePhoneNumbers(ResolveListener *listener, const QStringList &numbers, bool requireComplete = true);
+    static void resolveEmailAddresses(ResolveListener *listener, const QStringList &addresses, bool requireComplete = true);
+
+    static int unknownAddressHits();
+    static int unknownAddressMisses();
+
     static bool saveContact(const QContact &contact);
     static bool removeContact(const QContact &contact);
     static bool removeContacts(const QList<QContact> &contacts);
@@ -337,11 +367,16 @@ public:
     static bool fetchMergeCandidates(const QContact &contact);
 
     static int importContacts(const QString &path);
+    static SeasideImportJob *startImport(const QString &path);
     static QString exportContacts();
+    static SeasideExportJob *startExport();
 
     static const QList<quint32> *contacts(FilterType filterType);
     static bool isPopulated(FilterType filterType);
 
+    static QList<quint32> searchContacts(const QString &query);
+    static QList<quint32> searchDialpad(const QString &digits);
+
     static QString primaryName(const QString &firstName, const QString &lastName);
     static QString secondaryName(const QString &firstName, const QString &lastName);
 
@@ -358,6 +393,7 @@ public:
     // For synchronizeLists()
     int insertRange(int index, int count, const QList<quint32> &source, int sourceIndex) { return insertRange(m_syncFilter, index, count, source, sourceIndex); }
     int removeRange(int index, int count) { removeRange(m_syncFilter, index, count); return 0; }
+    void moveRange(int index, int count, int destination) { moveRange(m_syncFilter, index, count, destination); }
 
 protected:
     void timerEvent(QTimerEvent *event);
@@ -383,12 +419,16 @@ private slots:
 private:
     enum PopulateProgress {
         Unpopulated,
-        FetchFavorites,
-        FetchMetadata,
-        FetchOnline,
+        Populating,
         Populated
     };
 
+    // Saves are made in chunks, each queued behind the one being saved
+    enum {
+        SaveRequestCount = 2,
+        MaxSaveChunkSize = 250
+    };
+
     SeasideCache();
     ~SeasideCache();
 
@@ -401,25 +441,47 @@ private:
     void fetchContacts();
     void updateContacts(const QList<QContactId> &contactIds, QList<QContactId> *updateList);
     void applyPendingContactUpdates();
+    static int updateSliceSize(qint64 contactCostNs, qint64 remainingNs, int initialSize);
+    static void recordUpdateCost(qint64 *contactCostNs, int count, qint64 elapsedNs);
     void applyContactUpdates(const QList<QContact> &contacts, const QSet<QContactDetail::DetailType> &queryDetailTypes);
     void updateSectionBucketIndexCaches();
+    void updateSectionBucketIndexCaches(FilterType filter);
 
     void resolveUnknownAddresses(const QString &first, const QString &second, CacheItem *item);
     bool updateContactIndexing(const QContact &oldContact, const QContact &contact, quint32 iid, const QSet<QContactDetail::DetailType> &queryDetailTypes, CacheItem *item);
     void updateCache(CacheItem *item, const QContact &contact, bool partialFetch, bool initialInsert);
+    void updateSearchIndexing(const CacheItem *item);
+    void ensureSearchIndexing();
+    bool sortContactsLocally();
     void reportItemUpdated(CacheItem *item);
 
     void removeRange(FilterType filter, int index, int count);
     int insertRange(FilterType filter, int index, int count, const QList<quint32> &queryIds, int queryIndex);
+    void moveRange(FilterType filter, int index, int count, int destination);
+    void synchronizeContacts(const QList<quint32> &queryIds, int &cacheIndex, int &queryIndex);
 
     void contactDataChanged(quint32 iid);
     void contactDataChanged(quint32 iid, FilterType filter);
     void removeContactData(quint32 iid, FilterType filter);
     void makePopulated(FilterType filter);
+    void populationComplete(FilterType filter);
+    FilterType populateFilter(const QContactAbstractRequest *request) const;
+    void startPopulateRequest(FilterType filter);
+    void startPopulateIdRequest();
+    bool viewportReported() const;
+
+    void beginViewportPopulation();
+    void prioritizeViewport(ListModel *model);
+    void startViewportFetch();
+
+    void loadSnapshot();
+    void saveSnapshot();
 
     void addToContactDisplayLabelGroup(quint32 iid, const QString &group, QSet<QString> *modifiedGroups = 0);
     void removeFromContactDisplayLabelGroup(quint32 iid, const QString &group, QSet<QString> *modifiedGroups = 0);
     void notifyDisplayLabelGroupsChanged(const QSet<QString> &groups);
+    void reportDisplayLabelOrderChanges();
+    void labelOrderRowsChanged(FilterType filter, int row);
 
     void updateConstituentAggregations(const QContactId &contactId);
     void completeContactAggregation(const QContactId &contact1Id, const QContactId &contact2Id);
@@ -431,6 +493,7 @@ private:
     int contactIndex(quint32 iid, FilterType filter);
 
     void notifySaveContactComplete(int constituentId, int aggregateId);
+    void fetchSavedAggregates(const QList<QContact> &contacts);
 
     static QContactRelationship makeRelationship(const QString &type, const QContactId &id1, const QContactId &id2);
     static QContactRelationship makeRelationship(const QString &type, const QContact &contact1, const QContact &contact2);
@@ -439,13 +502,20 @@ private:
 
     QBasicTimer m_expiryTimer;
     QBasicTimer m_fetchTimer;
-    QHash<quint32, CacheItem> m_people;
-    QMultiHash<QString, CachedPhoneNumber> m_phoneNumberIds;
+    QBasicTimer m_snapshotTimer;
+    QBasicTimer m_labelOrderTimer;
+    CacheItemStore<CacheItem> m_people;
+    QHash<quint32, QString> m_alternateDisplayLabels; // in the other display label order
+    SeasidePhoneNumberIndex m_phoneNumberIndex;
+    SeasideSearchIndex m_searchIndex;
+    SeasideDialpadIndex m_dialpadIndex;
     QHash<QString, quint32> m_emailAddressIds;
     QHash<QPair<QString, QString>, quint32> m_onlineAccountIds;
     QHash<QContactId, QContact> m_contactsToSave;
     QHash<QString, QSet<quint32> > m_contactDisplayLabelGroups;
     QList<QContact> m_contactsToCreate;
+    QList<SeasideImportJob *> m_importJobs;
+    QList<SeasideExportJob *> m_exportJobs;
     QHash<FilterType, QPair<QSet<QContactDetail::DetailType>, QList<QContact> > > m_contactsToAppend;
     QList<QPair<QSet<QContactDetail::DetailType>, QList<QContact> > > m_contactsToUpdate;
     QList<QContactId> m_contactsToRemove;
@@ -462,29 +532,47 @@ private:
     QList<ChangeListener*> m_changeListeners;
     QList<ListModel *> m_models[FilterTypesCount];
     QSet<QObject *> m_users;
-    QHash<QContactId,int> m_expiredContacts;
+    QHash<quint32,int> m_expiredContacts;
+    QList<quint32> m_labelOrderItems;
     QContactFetchRequest m_fetchRequest;
+    QContactFetchRequest m_priorityFetchRequest;
+    QContactFetchRequest m_viewportFetchRequest;
+    QContactIdFetchRequest m_populateIdRequest;
+    QContactFetchRequest m_populateRequests[FilterTypesCount];
     QContactFetchByIdRequest m_fetchByIdRequest;
     QContactIdFetchRequest m_contactIdRequest;
     QContactRelationshipFetchRequest m_relationshipsFetchRequest;
     QContactRemoveRequest m_removeRequest;
-    QContactSaveRequest m_saveRequest;
+    QContactSaveRequest m_saveRequests[SaveRequestCount];
+    QPointer<SeasideImportJob> m_savingImportJobs[SaveRequestCount];
+    int m_savingImportCounts[SaveRequestCount];
     QContactRelationshipSaveRequest m_relationshipSaveRequest;
     QContactRelationshipRemoveRequest m_relationshipRemoveRequest;
+    QList<quint32> m_populateIds[FilterTypesCount];
+    QList<quint32> m_populateOrder; // ordered IDs of the FilterAll list, until its content is loaded
+    QList<quint32> m_viewportIds;
+    QString m_viewportGroup;
     QList<QContactSortOrder> m_sortOrder;
     QList<QContactSortOrder> m_onlineSortOrder;
     FilterType m_syncFilter;
     int m_populated;
+    int m_provisionalFilters; // lists restored from the snapshot, not yet confirmed by query
     int m_cacheIndex;
     int m_queryIndex;
     int m_fetchProcessedCount;
+    int m_priorityFetchProcessedCount;
+    int m_viewportFetchProcessedCount;
+    int m_populateProcessedCount[FilterTypesCount];
+    int m_labelOrderRows[FilterTypesCount]; // next row to report after a display label order change
     int m_fetchByIdProcessedCount;
+    qint64 m_appendCostNs; // measured cost of appending a contact
+    qint64 m_updateCostNs; // measured cost of updating a contact
     DisplayLabelOrder m_displayLabelOrder;
     QString m_sortProperty;
     QString m_groupProperty;
     bool m_keepPopulated;
     PopulateProgress m_populateProgress;
-    bool m_populating; // true if current m_fetchRequest makes progress
+    int m_populating; // filters whose population request is active
     quint32 m_fetchTypes;
     quint32 m_extraFetchTypes;
     quint32 m_dataTypesFetched;
@@ -492,9 +580,21 @@ private:
     bool m_refreshRequired;
     bool m_contactsUpdated;
     bool m_displayOff;
+    bool m_snapshotDirty;
+    bool m_searchIndexing; // set once the search indexes are required
+    QByteArray m_snapshotChangeState;
     QSet<QContactId> m_constituentIds;
     QSet<QContactId> m_candidateIds;
 
+    struct Viewport {
+        Viewport() : first(0), last(-1), velocity(0) {}
+
+        int first;
+        int last;
+        qreal velocity; // rows per second, negative when scrolling towards the start
+    };
+    QHash<ListModel *, Viewport> m_viewports;
+
     struct ResolveData {
         QString first;
         QString second;
@@ -502,10 +602,32 @@ private:
         bool requireComplete;
         ResolveListener *listener;
     };
-    QHash<QContactFetchRequest *, ResolveData> m_resolveAddresses;
+
+    struct UnknownAddress {
+        UnknownAddress() : sequence(0), recorded(0) {}
+
+        QList<ResolveData> listeners; // waiting for the address to become known
+        quint64 sequence;             // most recent use, for LRU eviction
+        qint64 recorded;              // when the negative result was last confirmed, or -1 once expired
+    };
+
+    static QString unknownAddressKey(const QString &first, const QString &second);
+    bool isKnownUnknownAddress(const QString &first, const QString &second);
+    void recordUnknownAddress(const ResolveData &data);
+    static QContactFilter resolveFilter(const QString &first, const QString &second);
+    void startResolveRequest(const QContactFilter &filter, const QList<ResolveData> &addresses, bool requireComplete);
+    void resolveBatchAddresses();
+
+    QHash<QContactFetchRequest *, QList<ResolveData> > m_resolveAddresses;
+    QList<ResolveData> m_batchResolveAddresses; // queued for combined queries
+    QList<ResolveData> m_resolvedAddresses; // being reported from a completed query
     QSet<ResolveData> m_pendingResolve; // these have active requests already
     QList<ResolveData> m_unknownResolveAddresses;
-    QList<ResolveData> m_unknownAddresses;
+    QHash<QString, UnknownAddress> m_unknownAddresses;
+    QMap<quint64, QString> m_unknownAddressUse;
+    quint64 m_unknownAddressSequence;
+    int m_unknownAddressHits;
+    int m_unknownAddressMisses;
     QSet<QString> m_resolvedPhoneNumbers;
 
     QElapsedTimer m_timer;
@@ -33,12 +33,10 @@
 #include "seasidecontactbuilder.h"
 
 #include "seasidecache.h"
+#include "seasidelocalcontactindex.h"
 #include "seasidepropertyhandler.h"
 
-#include <QContactDetailFilter>
-#include <QContactFetchHint>
 #include <QContactManager>
-#include <QContactSortOrder>
 #include <QContactSyncTarget>
 
 #include <QContactAddress>
@@ -68,36 +66,48 @@
 #include <QVersitReader>
 #include <QVersitWriter>
 
+#include <QDateTime>
 #include <QHash>
 #include <QString>
 #include <QList>
+#include <QUrl>
+#include <QVector>
+#include <QRunnable>
+#include <QThreadPool>
 
 namespace {
 
-QContactFetchHint basicFetchHint()
-{
-    QContactFetchHint fetchHint;
-
-    fetchHint.setOptimizationHints(QContactFetchHint::NoRelationships |
-                                   QContactFetchHint::NoActionPreferences |
-                                   QContactFetchHint::NoBinaryBlobs);
+// Documents converted by a shard in parallel conversion, at least
+const int MinShardDocuments = 50;
 
-    return fetchHint;
+// Only a SeasidePropertyHandler can save avatar images in the background
+void setAvatarWrites(QVersitContactHandler *handler, bool asynchronous)
+{
+    if (SeasidePropertyHandler *seasideHandler = dynamic_cast<SeasidePropertyHandler *>(handler))
+        seasideHandler->setAsynchronousAvatarWrites(asynchronous);
 }
 
-QContactFilter localContactFilter()
+class ConversionShard : public QRunnable
 {
-    // Contacts that are local to the device have sync target 'local' or 'was_local' or 'bluetooth'
-    QContactDetailFilter filterLocal, filterWasLocal, filterBluetooth;
-    filterLocal.setDetailType(QContactSyncTarget::Type, QContactSyncTarget::FieldSyncTarget);
-    filterWasLocal.setDetailType(QContactSyncTarget::Type, QContactSyncTarget::FieldSyncTarget);
-    filterBluetooth.setDetailType(QContactSyncTarget::Type, QContactSyncTarget::FieldSyncTarget);
-    filterLocal.setValue(QString::fromLatin1("local"));
-    filterWasLocal.setValue(QString::fromLatin1("was_local"));
-    filterBluetooth.setValue(QString::fromLatin1("bluetooth"));
+public:
+    ConversionShard(const QList<QVersitDocument> &documents, QVersitContactHandler *handler)
+        : documents(documents), handler(handler)
+    {
+        setAutoDelete(false);
+    }
 
-    return filterLocal | filterWasLocal | filterBluetooth;
-}
+    void run()
+    {
+        QVersitContactImporter importer;
+        importer.setPropertyHandler(handler);
+        importer.importDocuments(documents);
+        contacts = importer.contacts();
+    }
+
+    const QList<QVersitDocument> documents;
+    QVersitContactHandler * const handler;
+    QList<QContact> contacts;
+};
 
 bool allCharactersMatchScript(const QString &s, QChar::Script script)
 {
@@ -132,33 +142,6 @@ bool applyNameFixes(QContactName *nameDetail)
     return true;
 }
 
-bool nameIsEmpty(const QContactName &name)
-{
-    if (name.isEmpty())
-        return true;
-
-    return (name.prefix().isEmpty() &&
-            name.firstName().isEmpty() &&
-            name.middleName().isEmpty() &&
-            name.lastName().isEmpty() &&
-            name.suffix().isEmpty());
-}
-
-QString contactNameString(const QContact &contact)
-{
-    QStringList details;
-    QContactName name(contact.detail<QContactName>());
-    if (nameIsEmpty(name))
-        return QString();
-
-    details.append(name.prefix());
-    details.append(name.firstName());
-    details.append(name.middleName());
-    details.append(name.lastName());
-    details.append(name.suffix());
-    return details.join(QChar::fromLatin1('|'));
-}
-
 void setNickname(QContact &contact, const QString &text)
 {
     foreach (const QContactNickname &nick, contact.details<QContactNickname>()) {
@@ -203,18 +186,15 @@ static bool variantEqual(const QVariant &lhs, const QVariant &rhs)
     return (lhs == rhs);
 }
 
-static bool detailValuesSuperset(const QContactDetail &lhs, const QContactDetail &rhs)
+static bool detailValuesSuperset(const DetailMap &lhsValues, const DetailMap &rhsValues)
 {
     // True if all values in rhs are present in lhs
-    const DetailMap lhsValues(detailValues(lhs));
-    const DetailMap rhsValues(detailValues(rhs));
-
     if (lhsValues.count() < rhsValues.count()) {
         return false;
     }
 
-    foreach (const DetailMap::key_type &key, rhsValues.keys()) {
-        if (!variantEqual(lhsValues[key], rhsValues[key])) {
+    for (DetailMap::const_iterator it = rhsValues.constBegin(), end = rhsValues.constEnd(); it != end; ++it) {
+        if (!variantEqual(lhsValues.value(it.key()), it.value())) {
             return false;
         }
     }
@@ -222,6 +202,57 @@ static bool detailValuesSuperset(const QContactDetail &lhs, const QContactDetail
     return true;
 }
 
+// Hash of a value which is equal for any values which variantEqual() considers equal; floating
+// point values are compared fuzzily, so they must not be hashed
+static uint variantHash(const QVariant &value)
+{
+    static const int QListIntType = QMetaType::type("QList<int>");
+
+    const int type = value.userType();
+    uint hash = qHash(type);
+
+    if (type == QListIntType) {
+        foreach (int element, value.value<QList<int> >()) {
+            hash = 31 * hash + qHash(element);
+        }
+    } else if (type == QMetaType::QDateTime) {
+        hash ^= qHash(value.toDateTime().toMSecsSinceEpoch());
+    } else if (type == QMetaType::QUrl) {
+        hash ^= qHash(value.toUrl());
+    } else {
+        hash ^= qHash(value.toString());
+    }
+
+    return hash;
+}
+
+// The values of a detail, with hashes summarizing them: details with equal values have equal
+// hashes, and a detail whose values are a superset of another's has all of the other's mask bits
+struct DetailFingerprint
+{
+    explicit DetailFingerprint(const QContactDetail &detail)
+        : values(detailValues(detail))
+        , hash(0)
+        , mask(0)
+    {
+        for (DetailMap::const_iterator it = values.constBegin(), end = values.constEnd(); it != end; ++it) {
+            // Invalid values match missing values, so neither contributes; nor do floating
+            // point values, which may match values that do not hash equally
+            const int type = it.value().userType();
+            if (!it.value().isValid() || type == QMetaType::Double || type == QMetaType::Float)
+                continue;
+
+            const uint valueHash = qHash(it.key()) ^ variantHash(it.value());
+            hash += valueHash;
+            mask |= Q_UINT64_C(1) << (valueHash % 64);
+        }
+    }
+
+    DetailMap values;
+    uint hash;
+    quint64 mask;
+};
+
 static void fixupDetail(QContactDetail &)
 {
 }
@@ -270,21 +301,36 @@ bool mergeContactDetails(QContact *mergeInto, const QContact &mergeFrom, bool si
 {
     bool rv = false;
 
-    QList<T> existingDetails(mergeInto->details<T>());
+    const QList<T> existingDetails(mergeInto->details<T>());
     if (singular && !existingDetails.isEmpty())
         return rv;
 
+    QVector<DetailFingerprint> existing;
+    existing.reserve(existingDetails.count());
+    QMultiHash<uint, int> existingHashes;
+    foreach (const T &detail, existingDetails) {
+        existing.append(DetailFingerprint(detail));
+        existingHashes.insert(existing.last().hash, existing.count() - 1);
+    }
+
     foreach (T detail, mergeFrom.details<T>()) {
         // Make any corrections to the input
         fixupDetail(detail);
 
-        // See if the contact already has a detail which is a superset of this one
+        const DetailFingerprint incoming(detail);
+
+        // See if the contact already has a detail which is a superset of this one; an identical
+        // detail is found by its hash, and otherwise only those with all the mask bits can be.
+        // Values which are not hashed may differ between details of equal hash, so each
+        // candidate is compared in full
         bool found = false;
-        foreach (const T &existing, existingDetails) {
-            if (detailValuesSuperset(existing, detail)) {
-                found = true;
-                break;
-            }
+        QMultiHash<uint, int>::const_iterator it = existingHashes.constFind(incoming.hash);
+        for ( ; !found && it != existingHashes.constEnd() && it.key() == incoming.hash; ++it) {
+            found = detailValuesSuperset(existing.at(*it).values, incoming.values);
+        }
+        for (int i = 0; !found && i < existing.count(); ++i) {
+            const DetailFingerprint &candidate(existing.at(i));
+            found = (incoming.mask & ~candidate.mask) == 0 && detailValuesSuperset(candidate.values, incoming.values);
         }
         if (!found) {
             mergeInto->saveDetail(&detail);
@@ -330,6 +376,8 @@ SeasideContactBuilder::SeasideContactBuilder()
     // defaults.  override in the ctor of your derived type.
     d->manager = 0;
     d->propertyHandler = 0;
+    d->conversionThreadCount = 1;
+    d->asynchronousAvatarWrites = false;
     d->unimportableDetailTypes = (QSet<QContactDetail::DetailType>() << QContactDetail::TypeGlobalPresence << QContactDetail::TypeVersion);
     d->importableSyncTargets = (QStringList() << QLatin1String("was_local") << QLatin1String("bluetooth"));
 }
@@ -363,7 +411,7 @@ QContactManager *SeasideContactBuilder::manager()
  */
 QContactFilter SeasideContactBuilder::mergeSubsetFilter() const
 {
-    return localContactFilter();
+    return SeasideLocalContactIndex::localContactFilter();
 }
 
 /*
@@ -375,12 +423,60 @@ QContactFilter SeasideContactBuilder::mergeSubsetFilter() const
 QVersitContactHandler *SeasideContactBuilder::propertyHandler()
 {
     if (!d->propertyHandler) {
-        d->propertyHandler = new SeasidePropertyHandler;
+        d->propertyHandler = createPropertyHandler();
     }
 
     return d->propertyHandler;
 }
 
+/*
+ * Returns a new versit property handler, owned by the caller.
+ * Each thread of a parallel conversion uses a handler of its own.
+ *
+ * The default implementation will return a SeasidePropertyHandler.
+ * Derived types which return a different handler from propertyHandler()
+ * must also override this function to use parallel conversion.
+ */
+QVersitContactHandler *SeasideContactBuilder::createPropertyHandler()
+{
+    return new SeasidePropertyHandler;
+}
+
+/*
+ * Sets the number of threads which may be used to convert versit
+ * documents in importContacts().  With more than one thread, the
+ * documents are divided into shards which are converted in parallel.
+ *
+ * The default is one thread, converting the documents in order.
+ */
+void SeasideContactBuilder::setConversionThreadCount(int count)
+{
+    d->conversionThreadCount = qMax(count, 1);
+}
+
+int SeasideContactBuilder::conversionThreadCount() const
+{
+    return d->conversionThreadCount;
+}
+
+/*
+ * Sets whether the SeasidePropertyHandler instances used by importContacts()
+ * save avatar images in the background.  If so, the caller must wait for
+ * the images with SeasidePropertyHandler::waitForAvatarsSaved() before
+ * saving the imported contacts.
+ *
+ * The default is to save each image as its document is converted.
+ */
+void SeasideContactBuilder::setAsynchronousAvatarWrites(bool asynchronous)
+{
+    d->asynchronousAvatarWrites = asynchronous;
+}
+
+bool SeasideContactBuilder::asynchronousAvatarWrites() const
+{
+    return d->asynchronousAvatarWrites;
+}
+
 /*
  * Merge the given (matching) \a local contact into the given
  * \a import contact, so that the \a import contact could be
@@ -444,15 +540,50 @@ bool SeasideContactBuilder::mergeImportIntoImport(QContact &import, QContact &ot
 
 /*
  * Import the given Versit \a documents as QContacts and return them.
- * The default implementation uses a SeasidePropertyHandler during import
+ * The default implementation uses a SeasidePropertyHandler during import.
+ * If more than one conversion thread is allowed, large document lists are
+ * converted in parallel shards; the contacts are returned in the order of
+ * the documents they were converted from in either case.
  */
 QList<QContact> SeasideContactBuilder::importContacts(const QList<QVersitDocument> &documents)
 {
-    QVersitContactHandler *handler = propertyHandler();
-    QVersitContactImporter importer;
-    importer.setPropertyHandler(handler);
-    importer.importDocuments(documents);
-    return importer.contacts();
+    const int shardCount = qMin(d->conversionThreadCount, documents.count() / MinShardDocuments);
+    if (shardCount <= 1) {
+        QVersitContactHandler *handler = propertyHandler();
+        setAvatarWrites(handler, d->asynchronousAvatarWrites);
+        QVersitContactImporter importer;
+        importer.setPropertyHandler(handler);
+        importer.importDocuments(documents);
+        return importer.contacts();
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(shardCount);
+
+    // Handlers are created on this thread, since derived types may not expect otherwise
+    QList<ConversionShard *> shards;
+    for (int i = 0; i < shardCount; ++i) {
+        const int begin = documents.count() * i / shardCount;
+        const int end = documents.count() * (i + 1) / shardCount;
+
+        QVersitContactHandler *handler = createPropertyHandler();
+        setAvatarWrites(handler, d->asynchronousAvatarWrites);
+
+        shards.append(new ConversionShard(documents.mid(begin, end - begin), handler));
+        pool.start(shards.last());
+    }
+
+    pool.waitForDone();
+
+    QList<QContact> contacts;
+    contacts.reserve(documents.count());
+    foreach (ConversionShard *shard, shards) {
+        contacts.append(shard->contacts);
+        delete shard->handler;
+        delete shard;
+    }
+
+    return contacts;
 }
 
 /*
@@ -488,7 +619,7 @@ void SeasideContactBuilder::preprocessContact(QContact &contact)
     }
 
     // Set nickname by default if the name is empty
-    if (contactNameString(contact).isEmpty()) {
+    if (SeasideLocalContactIndex::contactNameString(contact).isEmpty()) {
         QContactName nameDetail = contact.detail<QContactName>();
         contact.removeDetail(&nameDetail);
         if (contact.details<QContactNickname>().isEmpty()) {
@@ -520,7 +651,7 @@ int SeasideContactBuilder::previousDuplicateIndex(QList<QContact> &importedConta
 {
     QContact &contact(importedContacts[contactIndex]);
     const QString guid = contact.detail<QContactGuid>().guid();
-    const QString name = contactNameString(contact);
+    const QString name = SeasideLocalContactIndex::contactNameString(contact);
     const bool emptyName = name.isEmpty();
     const QString label = contact.detail<QContactDisplayLabel>().label().isEmpty()
                         ?SeasideCache::generateDisplayLabelFromNonNameDetails(contact)
@@ -534,7 +665,7 @@ int SeasideContactBuilder::previousDuplicateIndex(QList<QContact> &importedConta
         if (!emptyName) {
             // If we have a GUID match, but names differ, ignore the match
             const QContact &previous(importedContacts[previousIndex]);
-            const QString previousName = contactNameString(previous);
+            const QString previousName = SeasideLocalContactIndex::contactNameString(previous);
             if (!previousName.isEmpty() && (previousName != name)) {
                 previousIndex = -1;
 
@@ -587,25 +718,26 @@ int SeasideContactBuilder::previousDuplicateIndex(QList<QContact> &importedConta
 void SeasideContactBuilder::buildLocalDeviceContactIndexes()
 {
     // Find all names and GUIDs for local contacts that might match these contacts
-    QContactFetchHint fetchHint(basicFetchHint());
-    fetchHint.setDetailTypesHint(QList<QContactDetail::DetailType>() << QContactName::Type << QContactNickname::Type << QContactGuid::Type);
-
     QContactManager *mgr(manager());
-
-    foreach (const QContact &contact, mgr->contacts(mergeSubsetFilter(), QList<QContactSortOrder>(), fetchHint)) {
-        const QString guid = contact.detail<QContactGuid>().guid();
-        const QString name = contactNameString(contact);
-
-        if (!guid.isEmpty()) {
-            d->existingGuids.insert(guid, contact.id());
-        }
-        if (!name.isEmpty()) {
-            d->existingNames.insert(name, contact.id());
-            d->existingContactNames.insert(contact.id(), name);
-        }
-        foreach (const QContactNickname &nick, contact.details<QContactNickname>()) {
-            d->existingNicknames.insert(nick.nickname(), contact.id());
-        }
+    const QContactFilter filter(mergeSubsetFilter());
+
+    if (SeasideCache::isManager(mgr) && filter == SeasideLocalContactIndex::localContactFilter()) {
+        // The shared index only fetches the contacts modified since it was last refreshed
+        SeasideLocalContactIndex *index = SeasideCache::localContactIndex();
+        index->refresh();
+
+        d->existingGuids = index->guids();
+        d->existingNames = index->names();
+        d->existingContactNames = index->contactNames();
+        d->existingNicknames = index->nicknames();
+    } else {
+        SeasideLocalContactIndex index(mgr, filter);
+        index.refresh();
+
+        d->existingGuids = index.guids();
+        d->existingNames = index.names();
+        d->existingContactNames = index.contactNames();
+        d->existingNicknames = index.nicknames();
     }
 }
 
@@ -620,7 +752,7 @@ void SeasideContactBuilder::buildLocalDeviceContactIndexes()
 QContactId SeasideContactBuilder::matchingLocalContactId(QContact &contact)
 {
     const QString guid = contact.detail<QContactGuid>().guid();
-    const QString name = contactNameString(contact);
+    const QString name = SeasideLocalContactIndex::contactNameString(contact);
     const bool emptyName = name.isEmpty();
     QContactId existingId;
 
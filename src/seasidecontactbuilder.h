@@ -64,6 +64,9 @@ public:
     QHash<QString, QContactId> existingNicknames;
 
     QVariantMap extraData; // anything the derived type wants to store.
+
+    int conversionThreadCount;
+    bool asynchronousAvatarWrites;
 };
 
 class CONTACTCACHE_EXPORT SeasideContactBuilder
@@ -84,7 +87,13 @@ public:
     virtual int previousDuplicateIndex(QList<QContact> &importedContacts, int contactIndex);
     virtual void buildLocalDeviceContactIndexes();
     virtual QContactId matchingLocalContactId(QContact &contact);
+    virtual QVersitContactHandler *createPropertyHandler();
+
+    void setConversionThreadCount(int count);
+    int conversionThreadCount() const;
 
+    void setAsynchronousAvatarWrites(bool asynchronous);
+    bool asynchronousAvatarWrites() const;
 
 protected:
     SeasideContactBuilderPrivate *d;
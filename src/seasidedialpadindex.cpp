@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidedialpadindex.h"
+#include "seasidesearchindex.h"
+
+#include <QHash>
+#include <QMap>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+
+const QChar separator(QLatin1Char('\n'));
+
+QStringList nameDigits(const QString &name)
+{
+    QStringList rv;
+    for (const QString &token : SeasideSearchIndex::tokenize(name)) {
+        const QString digits(SeasideDialpadIndex::keypadDigits(token));
+        if (!digits.isEmpty())
+            rv.append(digits);
+    }
+    return rv;
+}
+
+QString numberDigits(const QString &number)
+{
+    QString rv;
+    rv.reserve(number.length());
+    for (const QChar &c : number) {
+        if (c.isDigit())
+            rv.append(c);
+    }
+    return rv;
+}
+
+}
+
+class SeasideDialpadIndexPrivate
+{
+public:
+    struct Entry
+    {
+        QStringList nameTokens; // in the order they occur in the name
+        QStringList numbers;
+        QVector<int> numberOffsets;
+    };
+
+    struct NumberRecord
+    {
+        int offset;
+        int length;
+        quint32 iid; // zero once the number is removed
+    };
+
+    SeasideDialpadIndexPrivate() : deadCharacters(0) {}
+
+    void link(quint32 iid, Entry *entry);
+    void unlink(quint32 iid, const Entry &entry);
+    void compact();
+
+    QVector<NumberRecord>::const_iterator record(int offset) const;
+
+    QHash<quint32, Entry> entries;
+    QMap<QString, QVector<quint32> > nameTokens;
+
+    // The digits of each number, followed by a separator, so that a substring match can
+    // be found with a single search over the buffer
+    QString numberBuffer;
+    QVector<NumberRecord> numberRecords; // ordered by offset
+    int deadCharacters;
+};
+
+void SeasideDialpadIndexPrivate::link(quint32 iid, Entry *entry)
+{
+    QStringList tokens(entry->nameTokens);
+    tokens.removeDuplicates();
+    for (const QString &token : tokens) {
+        QVector<quint32> &iids(nameTokens[token]);
+        QVector<quint32>::iterator it = std::lower_bound(iids.begin(), iids.end(), iid);
+        if (it == iids.end() || *it != iid)
+            iids.insert(it, iid);
+    }
+
+    entry->numberOffsets.clear();
+    for (const QString &number : entry->numbers) {
+        NumberRecord record = { numberBuffer.length(), number.length(), iid };
+        numberRecords.append(record);
+        entry->numberOffsets.append(record.offset);
+
+        numberBuffer.append(number);
+        numberBuffer.append(separator);
+    }
+}
+
+void SeasideDialpadIndexPrivate::unlink(quint32 iid, const Entry &entry)
+{
+    for (const QString &token : entry.nameTokens) {
+        QMap<QString, QVector<quint32> >::iterator tit = nameTokens.find(token);
+        if (tit == nameTokens.end())
+            continue;
+
+        QVector<quint32> &iids(*tit);
+        QVector<quint32>::iterator it = std::lower_bound(iids.begin(), iids.end(), iid);
+        if (it != iids.end() && *it == iid)
+            iids.erase(it);
+        if (iids.isEmpty())
+            nameTokens.erase(tit);
+    }
+
+    for (int offset : entry.numberOffsets) {
+        QVector<NumberRecord>::iterator it = numberRecords.begin() + (record(offset) - numberRecords.constBegin());
+        if (it->iid != iid)
+            continue;
+
+        // Overwrite the digits so they can no longer be matched
+        it->iid = 0;
+        numberBuffer.replace(it->offset, it->length, QString(it->length, separator));
+        deadCharacters += it->length + 1;
+    }
+}
+
+void SeasideDialpadIndexPrivate::compact()
+{
+    static const int MinimumDeadCharacters = 4096;
+
+    if (deadCharacters < MinimumDeadCharacters || deadCharacters * 2 < numberBuffer.length())
+        return;
+
+    QString buffer;
+    buffer.reserve(numberBuffer.length() - deadCharacters);
+    QVector<NumberRecord> records;
+    records.reserve(numberRecords.count());
+
+    for (QHash<quint32, Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        it->numberOffsets.clear();
+    }
+
+    for (const NumberRecord &record : numberRecords) {
+        if (!record.iid)
+            continue;
+
+        NumberRecord moved = { buffer.length(), record.length, record.iid };
+        records.append(moved);
+        entries[record.iid].numberOffsets.append(moved.offset);
+
+        buffer.append(numberBuffer.midRef(record.offset, record.length));
+        buffer.append(separator);
+    }
+
+    numberBuffer = buffer;
+    numberRecords = records;
+    deadCharacters = 0;
+}
+
+QVector<SeasideDialpadIndexPrivate::NumberRecord>::const_iterator SeasideDialpadIndexPrivate::record(int offset) const
+{
+    // Find the last record starting at or before the offset
+    QVector<NumberRecord>::const_iterator it = std::upper_bound(numberRecords.constBegin(), numberRecords.constEnd(), offset,
+                                                                [](int offset, const NumberRecord &record) {
+        return offset < record.offset;
+    });
+    return it - 1;
+}
+
+SeasideDialpadIndex::SeasideDialpadIndex()
+    : d(new SeasideDialpadIndexPrivate)
+{
+}
+
+SeasideDialpadIndex::~SeasideDialpadIndex()
+{
+    delete d;
+}
+
+int SeasideDialpadIndex::count() const
+{
+    return d->entries.count();
+}
+
+bool SeasideDialpadIndex::contains(quint32 iid) const
+{
+    return d->entries.contains(iid);
+}
+
+void SeasideDialpadIndex::insert(quint32 iid, const QString &name, const QStringList &numbers)
+{
+    SeasideDialpadIndexPrivate::Entry entry;
+    entry.nameTokens = nameDigits(name);
+    for (const QString &number : numbers) {
+        const QString digits(numberDigits(number));
+        if (!digits.isEmpty() && !entry.numbers.contains(digits))
+            entry.numbers.append(digits);
+    }
+
+    QHash<quint32, SeasideDialpadIndexPrivate::Entry>::iterator it = d->entries.find(iid);
+    if (it != d->entries.end()) {
+        if (it->nameTokens == entry.nameTokens && it->numbers == entry.numbers)
+            return;
+
+        d->unlink(iid, *it);
+        d->entries.erase(it);
+    }
+
+    if (!entry.nameTokens.isEmpty() || !entry.numbers.isEmpty()) {
+        d->link(iid, &entry);
+        d->entries.insert(iid, entry);
+    }
+
+    d->compact();
+}
+
+/*
+ * Replaces the name indexed for the contact \a iid, keeping its numbers.  If the
+ * name has the same tokens in a different order, as when the display label order
+ * changes, only the ranking of the tokens is updated.
+ */
+void SeasideDialpadIndex::setName(quint32 iid, const QString &name)
+{
+    QHash<quint32, SeasideDialpadIndexPrivate::Entry>::iterator it = d->entries.find(iid);
+    if (it == d->entries.end()) {
+        insert(iid, name, QStringList());
+        return;
+    }
+
+    const QStringList tokens(nameDigits(name));
+    if (tokens == it->nameTokens)
+        return;
+
+    QStringList sortedTokens(tokens);
+    QStringList sortedExisting(it->nameTokens);
+    std::sort(sortedTokens.begin(), sortedTokens.end());
+    std::sort(sortedExisting.begin(), sortedExisting.end());
+    if (sortedTokens == sortedExisting) {
+        it->nameTokens = tokens;
+        return;
+    }
+
+    insert(iid, name, it->numbers);
+}
+
+void SeasideDialpadIndex::remove(quint32 iid)
+{
+    QHash<quint32, SeasideDialpadIndexPrivate::Entry>::iterator it = d->entries.find(iid);
+    if (it != d->entries.end()) {
+        d->unlink(iid, *it);
+        d->entries.erase(it);
+        d->compact();
+    }
+}
+
+void SeasideDialpadIndex::clear()
+{
+    d->entries.clear();
+    d->nameTokens.clear();
+    d->numberBuffer.clear();
+    d->numberRecords.clear();
+    d->deadCharacters = 0;
+}
+
+QList<quint32> SeasideDialpadIndex::search(const QString &digits) const
+{
+    const QString query(numberDigits(digits));
+    if (query.isEmpty())
+        return QList<quint32>();
+
+    QHash<quint32, int> ranks;
+
+    QMap<QString, QVector<quint32> >::const_iterator it = d->nameTokens.lowerBound(query), end = d->nameTokens.constEnd();
+    for ( ; it != end && it.key().startsWith(query); ++it) {
+        for (quint32 iid : *it) {
+            int &rank(ranks[iid]);
+            if (rank < NamePrefix) {
+                const SeasideDialpadIndexPrivate::Entry &entry(*d->entries.find(iid));
+                rank = entry.nameTokens.first().startsWith(query) ? FirstNamePrefix : NamePrefix;
+            }
+        }
+    }
+
+    for (int from = 0, pos; (pos = d->numberBuffer.indexOf(query, from)) != -1; ) {
+        const SeasideDialpadIndexPrivate::NumberRecord &record(*d->record(pos));
+        if (record.iid) {
+            int &rank(ranks[record.iid]);
+            rank = qMax(rank, static_cast<int>(pos == record.offset ? NumberPrefix : NumberSubstring));
+        }
+
+        // Only the first match within each number is relevant
+        from = record.offset + record.length + 1;
+    }
+
+    QVector<QPair<int, quint32> > ranked;
+    ranked.reserve(ranks.count());
+    for (QHash<quint32, int>::const_iterator rit = ranks.constBegin(); rit != ranks.constEnd(); ++rit) {
+        ranked.append(qMakePair(-rit.value(), rit.key()));
+    }
+    std::sort(ranked.begin(), ranked.end());
+
+    QList<quint32> rv;
+    rv.reserve(ranked.count());
+    for (const QPair<int, quint32> &match : ranked) {
+        rv.append(match.second);
+    }
+    return rv;
+}
+
+SeasideDialpadIndex::MatchRank SeasideDialpadIndex::rank(quint32 iid, const QString &digits) const
+{
+    const QString query(numberDigits(digits));
+    QHash<quint32, SeasideDialpadIndexPrivate::Entry>::const_iterator it = d->entries.constFind(iid);
+    if (query.isEmpty() || it == d->entries.constEnd())
+        return NoMatch;
+
+    if (!it->nameTokens.isEmpty() && it->nameTokens.first().startsWith(query))
+        return FirstNamePrefix;
+
+    MatchRank rv = NoMatch;
+    for (const QString &number : it->numbers) {
+        const int pos = number.indexOf(query);
+        if (pos == 0) {
+            return NumberPrefix;
+        } else if (pos > 0) {
+            rv = NumberSubstring;
+        }
+    }
+    for (const QString &token : it->nameTokens) {
+        if (token.startsWith(query))
+            return NamePrefix;
+    }
+    return rv;
+}
+
+QString SeasideDialpadIndex::keypadDigits(const QString &token)
+{
+    // The ITU E.161 assignment of latin letters to keys
+    static const char keys[] = "22233344455566677778889999";
+
+    QString rv;
+    rv.reserve(token.length());
+    for (const QChar &c : token) {
+        const ushort u = c.toLower().unicode();
+        if (u >= 'a' && u <= 'z') {
+            rv.append(QLatin1Char(keys[u - 'a']));
+        } else if (u >= '0' && u <= '9') {
+            rv.append(c);
+        } else {
+            // The token cannot be entered from the keypad
+            return QString();
+        }
+    }
+    return rv;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#ifndef SEASIDEDIALPADINDEX_H
+#define SEASIDEDIALPADINDEX_H
+
+#include "contactcacheexport.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class SeasideDialpadIndexPrivate;
+
+// Index of cached contacts by the digits that would be entered on a phone keypad.  Each
+// token of the contact's name is indexed as the sequence of keys bearing its letters, and
+// matches digits entered as a prefix of that sequence.  Phone numbers are held as digits in
+// a single contiguous buffer, and match digits entered anywhere within the number.
+
+class CONTACTCACHE_EXPORT SeasideDialpadIndex
+{
+public:
+    enum MatchRank {
+        NoMatch = 0,
+        NumberSubstring,
+        NamePrefix,
+        NumberPrefix,
+        FirstNamePrefix
+    };
+
+    SeasideDialpadIndex();
+    ~SeasideDialpadIndex();
+
+    int count() const;
+    bool contains(quint32 iid) const;
+
+    // Replaces any names and numbers previously indexed for the contact
+    void insert(quint32 iid, const QString &name, const QStringList &numbers);
+    void setName(quint32 iid, const QString &name);
+    void remove(quint32 iid);
+    void clear();
+
+    // Returns the contacts matching the digits, in descending order of rank
+    QList<quint32> search(const QString &digits) const;
+    MatchRank rank(quint32 iid, const QString &digits) const;
+
+    static QString keypadDigits(const QString &token);
+
+private:
+    Q_DISABLE_COPY(SeasideDialpadIndex)
+
+    SeasideDialpadIndexPrivate *d;
+};
+
+#endif
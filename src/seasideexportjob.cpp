@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include "seasideexportjob.h"
+
+#include <QContactFetchByIdRequest>
+#include <QContactFetchHint>
+#include <QContactIdFetchRequest>
+
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <QVersitContactExporter>
+#include <QVersitWriter>
+
+#include <QtDebug>
+
+QTVERSIT_USE_NAMESPACE
+
+namespace {
+
+// Contacts fetched together, and fetched pages which may await writing
+const int PageContacts = 100;
+const int MaxPendingPages = 2;
+
+}
+
+class SeasideExportJobPrivate : public QThread
+{
+public:
+    SeasideExportJobPrivate(SeasideExportJob *job, QContactManager *manager, const QList<QContactId> &contactIds, const QString &path)
+        : q(job)
+        , contactIds(contactIds)
+        , path(path)
+        , status(SeasideExportJob::Inactive)
+        , idsFetched(true)
+        , nextIndex(0)
+        , cancelled(false)
+        , complete(false)
+        , failed(false)
+        , contactsWritten(0)
+    {
+        QContactFetchHint fetchHint;
+        fetchHint.setOptimizationHints(QContactFetchHint::NoRelationships | QContactFetchHint::NoActionPreferences);
+
+        fetchRequest.setManager(manager);
+        fetchRequest.setFetchHint(fetchHint);
+        idRequest.setManager(manager);
+    }
+
+    void run();
+    bool writePage(QFile *file, const QList<QContact> &contacts);
+
+    SeasideExportJob * const q;
+    QList<QContactId> contactIds;
+    const QString path;
+    SeasideExportJob::Status status;
+    QContactIdFetchRequest idRequest;
+    bool idsFetched;
+    QContactFetchByIdRequest fetchRequest;
+    int nextIndex;
+
+    // Shared with the worker thread
+    mutable QMutex mutex;
+    QWaitCondition pageAvailable;
+    QList<QList<QContact> > pages;
+    bool cancelled;
+    bool complete;
+    bool failed;
+    int contactsWritten;
+};
+
+void SeasideExportJobPrivate::run()
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << Q_FUNC_INFO << "Cannot open " << path;
+        QMutexLocker locker(&mutex);
+        failed = true;
+        return;
+    }
+
+    forever {
+        QList<QContact> contacts;
+        {
+            QMutexLocker locker(&mutex);
+            while (pages.isEmpty() && !complete && !cancelled)
+                pageAvailable.wait(&mutex);
+
+            if (cancelled || pages.isEmpty())
+                break;
+
+            contacts = pages.takeFirst();
+        }
+
+        if (!writePage(&file, contacts)) {
+            QMutexLocker locker(&mutex);
+            failed = true;
+            break;
+        }
+
+        {
+            QMutexLocker locker(&mutex);
+            contactsWritten += contacts.count();
+        }
+
+        QMetaObject::invokeMethod(q, "pageWritten", Qt::QueuedConnection);
+    }
+
+    file.close();
+}
+
+bool SeasideExportJobPrivate::writePage(QFile *file, const QList<QContact> &contacts)
+{
+    QVersitContactExporter exporter;
+    if (!exporter.exportContacts(contacts)) {
+        // Contacts which can be exported are still written
+        qWarning() << Q_FUNC_INFO << "Failed to export contacts: " << exporter.errorMap();
+    }
+
+    QVersitWriter writer(file);
+    if (!writer.startWriting(exporter.documents())) {
+        qWarning() << Q_FUNC_INFO << "Can't start writing vcards " << writer.error();
+        return false;
+    }
+
+    writer.waitForFinished();
+    if (writer.error() != QVersitWriter::NoError) {
+        qWarning() << Q_FUNC_INFO << "Error writing vcards " << writer.error();
+        return false;
+    }
+
+    return true;
+}
+
+SeasideExportJob::SeasideExportJob(QContactManager *manager, const QList<QContactId> &contactIds, const QString &path, QObject *parent)
+    : QObject(parent)
+    , d(new SeasideExportJobPrivate(this, manager, contactIds, path))
+{
+    connect(&d->fetchRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)), this, SLOT(pageFetched()));
+    connect(d, SIGNAL(finished()), this, SLOT(writingFinished()));
+}
+
+/*
+ * Exports the contacts matching \a filter, in the order given by \a sorting,
+ * except for the self contact of \a manager.  The ids of the contacts are
+ * fetched asynchronously when the job is started, so contactsTotal() is zero
+ * until the first progressChanged() signal.
+ */
+SeasideExportJob::SeasideExportJob(QContactManager *manager, const QContactFilter &filter, const QList<QContactSortOrder> &sorting, const QString &path, QObject *parent)
+    : QObject(parent)
+    , d(new SeasideExportJobPrivate(this, manager, QList<QContactId>(), path))
+{
+    d->idsFetched = false;
+    d->idRequest.setFilter(filter);
+    d->idRequest.setSorting(sorting);
+
+    connect(&d->idRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)), this, SLOT(idsFetched()));
+    connect(&d->fetchRequest, SIGNAL(stateChanged(QContactAbstractRequest::State)), this, SLOT(pageFetched()));
+    connect(d, SIGNAL(finished()), this, SLOT(writingFinished()));
+}
+
+SeasideExportJob::~SeasideExportJob()
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->cancelled = true;
+        d->pageAvailable.wakeAll();
+    }
+
+    d->wait();
+    delete d;
+}
+
+QString SeasideExportJob::path() const
+{
+    return d->path;
+}
+
+SeasideExportJob::Status SeasideExportJob::status() const
+{
+    return d->status;
+}
+
+int SeasideExportJob::contactsWritten() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->contactsWritten;
+}
+
+int SeasideExportJob::contactsTotal() const
+{
+    return d->contactIds.count();
+}
+
+void SeasideExportJob::start()
+{
+    if (d->status != Inactive)
+        return;
+
+    d->status = Active;
+    d->start(QThread::LowPriority);
+
+    if (!d->idsFetched) {
+        d->idRequest.start();
+    } else {
+        fetchNextPage();
+    }
+}
+
+void SeasideExportJob::cancel()
+{
+    if (d->status != Active)
+        return;
+
+    d->status = Cancelled;
+    d->idRequest.cancel();
+    d->fetchRequest.cancel();
+
+    QMutexLocker locker(&d->mutex);
+    d->cancelled = true;
+    d->pages.clear();
+    d->pageAvailable.wakeAll();
+}
+
+void SeasideExportJob::fetchNextPage()
+{
+    if (d->status != Active || !d->idsFetched || d->fetchRequest.isActive())
+        return;
+
+    QMutexLocker locker(&d->mutex);
+
+    if (d->nextIndex == d->contactIds.count()) {
+        // Everything has been fetched; the writer can finish once the pages are written
+        d->complete = true;
+        d->pageAvailable.wakeAll();
+    } else if (d->pages.count() < MaxPendingPages) {
+        locker.unlock();
+
+        d->fetchRequest.setIds(d->contactIds.mid(d->nextIndex, PageContacts));
+        d->fetchRequest.start();
+    }
+}
+
+void SeasideExportJob::idsFetched()
+{
+    if (d->idRequest.state() != QContactAbstractRequest::FinishedState || d->status != Active)
+        return;
+
+    if (d->idRequest.error() != QContactManager::NoError) {
+        qWarning() << Q_FUNC_INFO << "Failed to fetch contact ids:" << d->idRequest.error();
+
+        QMutexLocker locker(&d->mutex);
+        d->failed = true;
+        d->cancelled = true;
+        d->pageAvailable.wakeAll();
+        return;
+    }
+
+    d->contactIds = d->idRequest.ids();
+    d->contactIds.removeAll(d->idRequest.manager()->selfContactId());
+    d->idsFetched = true;
+
+    emit progressChanged();
+
+    fetchNextPage();
+}
+
+void SeasideExportJob::pageFetched()
+{
+    if (d->fetchRequest.state() != QContactAbstractRequest::FinishedState || d->status != Active)
+        return;
+
+    // Ids which could not be fetched yield empty contacts
+    QList<QContact> contacts;
+    contacts.reserve(d->fetchRequest.contacts().count());
+    foreach (const QContact &contact, d->fetchRequest.contacts()) {
+        if (!contact.id().isNull())
+            contacts.append(contact);
+    }
+
+    d->nextIndex = qMin(d->nextIndex + PageContacts, d->contactIds.count());
+
+    {
+        QMutexLocker locker(&d->mutex);
+        d->pages.append(contacts);
+        d->pageAvailable.wakeAll();
+    }
+
+    fetchNextPage();
+}
+
+void SeasideExportJob::pageWritten()
+{
+    emit progressChanged();
+
+    fetchNextPage();
+}
+
+void SeasideExportJob::writingFinished()
+{
+    bool failed;
+    {
+        QMutexLocker locker(&d->mutex);
+        failed = d->failed;
+    }
+
+    if (d->status == Active)
+        d->status = failed ? Error : Finished;
+
+    if (d->status != Finished)
+        QFile::remove(d->path);
+
+    emit progressChanged();
+    emit finished();
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#ifndef SEASIDEEXPORTJOB_H
+#define SEASIDEEXPORTJOB_H
+
+#include "contactcacheexport.h"
+
+#include <QContact>
+#include <QContactFilter>
+#include <QContactManager>
+#include <QContactSortOrder>
+#include <QObject>
+#include <QString>
+
+QTCONTACTS_USE_NAMESPACE
+
+class SeasideExportJobPrivate;
+
+// Exports contacts to a vCard file without blocking the calling thread.  The contacts are
+// fetched from the manager in pages, and each page is converted and appended to the file on
+// a worker thread; the next page is not fetched while too many are waiting to be written, so
+// the memory used does not depend on the number of contacts exported.  The file is removed
+// if the export is cancelled or fails.
+
+class CONTACTCACHE_EXPORT SeasideExportJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Status {
+        Inactive,
+        Active,
+        Finished,
+        Cancelled,
+        Error
+    };
+
+    SeasideExportJob(QContactManager *manager, const QList<QContactId> &contactIds, const QString &path, QObject *parent = 0);
+    SeasideExportJob(QContactManager *manager, const QContactFilter &filter, const QList<QContactSortOrder> &sorting, const QString &path, QObject *parent = 0);
+    ~SeasideExportJob();
+
+    QString path() const;
+    Status status() const;
+
+    int contactsWritten() const;
+    int contactsTotal() const;
+
+    void start();
+    void cancel();
+
+signals:
+    void progressChanged();
+    void finished();
+
+private slots:
+    void idsFetched();
+    void pageFetched();
+    void pageWritten();
+    void writingFinished();
+
+private:
+    void fetchNextPage();
+
+    Q_DISABLE_COPY(SeasideExportJob)
+
+    SeasideExportJobPrivate *d;
+};
+
+#endif
@@ -31,11 +31,31 @@
 
 #include "seasideimport.h"
 
+#include "seasidepropertyhandler.h"
+
+#include <QContactAvatar>
 #include <QContactIdFilter>
 #include <QContact>
 #include <QContactManager>
 
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QThread>
+
+#include <QtDebug>
+
 namespace {
+    // Existing contacts fetched together when merging matched imports
+    const int ExistingFetchChunkSize = 200;
+
+    // Documents converted together when the import reports progress
+    const int ConversionBatchSize = 500;
+
+    // Minimum interval between progress notifications within a phase
+    const int ProgressIntervalMs = 100;
+
     QContactFetchHint basicFetchHint()
     {
         QContactFetchHint fetchHint;
@@ -44,25 +64,231 @@ namespace {
                                        QContactFetchHint::NoBinaryBlobs);
         return fetchHint;
     }
+
+    void beginPhase(SeasideImportProgress *progress, SeasideImportProgress::Phase phase, int itemsTotal)
+    {
+        if (progress)
+            progress->beginPhase(phase, itemsTotal);
+    }
+
+    bool advance(SeasideImportProgress *progress, int items = 1)
+    {
+        return !progress || progress->advance(items);
+    }
+
+    // Waits for the avatar images referred to by the contacts to be saved, and removes
+    // the avatars whose images could not be
+    void waitForAvatars(QList<QContact> *contacts)
+    {
+        QStringList paths;
+        foreach (const QContact &contact, *contacts) {
+            foreach (const QContactAvatar &avatar, contact.details<QContactAvatar>()) {
+                if (avatar.imageUrl().isLocalFile())
+                    paths.append(avatar.imageUrl().toLocalFile());
+            }
+        }
+
+        const QSet<QString> failedPaths(SeasidePropertyHandler::waitForAvatarsSaved(paths).toSet());
+        if (failedPaths.isEmpty())
+            return;
+
+        for (QList<QContact>::iterator it = contacts->begin(); it != contacts->end(); ++it) {
+            foreach (QContactAvatar avatar, it->details<QContactAvatar>()) {
+                if (avatar.imageUrl().isLocalFile() && failedPaths.contains(avatar.imageUrl().toLocalFile()))
+                    it->removeDetail(&avatar);
+            }
+        }
+    }
+}
+
+class SeasideImportProgressPrivate
+{
+public:
+    SeasideImportProgressPrivate()
+        : phase(SeasideImportProgress::Inactive)
+        , itemsProcessed(0)
+        , itemsTotal(0)
+    {
+    }
+
+    mutable QMutex mutex;
+    SeasideImportProgress::Phase phase;
+    int itemsProcessed;
+    int itemsTotal;
+    QElapsedTimer phaseTimer;
+    QElapsedTimer notifyTimer;
+
+    QAtomicInt cancelled;
+};
+
+SeasideImportProgress::SeasideImportProgress(QObject *parent)
+    : QObject(parent)
+    , d(new SeasideImportProgressPrivate)
+{
+}
+
+SeasideImportProgress::~SeasideImportProgress()
+{
+    delete d;
+}
+
+SeasideImportProgress::Phase SeasideImportProgress::phase() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->phase;
+}
+
+int SeasideImportProgress::itemsProcessed() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->itemsProcessed;
+}
+
+int SeasideImportProgress::itemsTotal() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->itemsTotal;
+}
+
+/*
+ * Returns the rate at which items have been processed in the current phase.
+ */
+qreal SeasideImportProgress::itemsPerSecond() const
+{
+    QMutexLocker locker(&d->mutex);
+    if (!d->phaseTimer.isValid())
+        return 0;
+
+    return d->itemsProcessed * 1000.0 / qMax<qint64>(1, d->phaseTimer.elapsed());
+}
+
+/*
+ * Requests that the import stop.  This may be called from any thread; the
+ * import stops before it processes its next item, and returns no contacts.
+ */
+void SeasideImportProgress::cancel()
+{
+    d->cancelled.storeRelease(1);
+}
+
+bool SeasideImportProgress::isCancelled() const
+{
+    return d->cancelled.loadAcquire() != 0;
+}
+
+/*
+ * Starts the given \a phase of the import, which has \a itemsTotal items to process.
+ */
+void SeasideImportProgress::beginPhase(Phase phase, int itemsTotal)
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->phase = phase;
+        d->itemsProcessed = 0;
+        d->itemsTotal = itemsTotal;
+        d->phaseTimer.start();
+        d->notifyTimer.start();
+    }
+
+    emit progressChanged();
+}
+
+/*
+ * Records that \a items more items of the current phase have been processed.
+ * Returns false if the import has been cancelled, and should stop.
+ */
+bool SeasideImportProgress::advance(int items)
+{
+    bool notify = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        d->itemsProcessed += items;
+        if (d->itemsProcessed >= d->itemsTotal || d->notifyTimer.hasExpired(ProgressIntervalMs)) {
+            d->notifyTimer.start();
+            notify = true;
+        }
+    }
+
+    if (notify)
+        emit progressChanged();
+
+    return !isCancelled();
+}
+
+void SeasideImportProgress::finish()
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->phase = isCancelled() ? Cancelled : Finished;
+    }
+
+    emit progressChanged();
 }
 
 QList<QContact> SeasideImport::buildImportContacts(const QList<QVersitDocument> &details, int *newCount, int *updatedCount, int *ignoredCount, SeasideContactBuilder *contactBuilder)
+{
+    return buildImportContacts(details, newCount, updatedCount, ignoredCount, contactBuilder, 0);
+}
+
+/*
+ * Converts the versit documents in \a details to contacts, and matches them
+ * with the existing local contacts which they update.
+ *
+ * If \a progress is provided, each phase of the import is reported to it,
+ * and the import is abandoned if it is cancelled; no contacts are returned
+ * by a cancelled import.
+ */
+QList<QContact> SeasideImport::buildImportContacts(const QList<QVersitDocument> &details, int *newCount, int *updatedCount, int *ignoredCount, SeasideContactBuilder *contactBuilder, SeasideImportProgress *progress)
 {
     if (newCount)
         *newCount = 0;
     if (updatedCount)
         *updatedCount = 0;
+    if (ignoredCount)
+        *ignoredCount = 0;
     bool eraseMatch = false;
 
-    SeasideContactBuilder *builder = contactBuilder
-                                   ? contactBuilder
-                                   : new SeasideContactBuilder;
-    QList<QContact> importedContacts = builder->importContacts(details);
+    SeasideContactBuilder *builder = contactBuilder;
+    if (!builder) {
+        // The handlers of the default builder can convert documents in parallel
+        builder = new SeasideContactBuilder;
+        builder->setConversionThreadCount(QThread::idealThreadCount());
+    }
 
-    // Preprocess the imported contacts and merge any duplicates in the import list
-    QList<QContact>::iterator it = importedContacts.begin();
-    while (it != importedContacts.end()) {
+    // Avatar images are saved in the background, and waited for before the contacts are returned
+    const bool asynchronousAvatarWrites = builder->asynchronousAvatarWrites();
+    builder->setAsynchronousAvatarWrites(true);
+
+    // Documents are converted in batches when reporting progress, so cancellation is not delayed
+    // until the whole list is converted
+    beginPhase(progress, SeasideImportProgress::Parse, details.count());
+    const int batchSize = progress ? ConversionBatchSize : qMax(details.count(), 1);
+
+    QList<QContact> importedContacts;
+    bool cancelled = false;
+    for (int index = 0; !cancelled && index < details.count(); index += batchSize) {
+        const QList<QVersitDocument> batch(details.mid(index, batchSize));
+        importedContacts.append(builder->importContacts(batch));
+        cancelled = !advance(progress, batch.count());
+    }
+    builder->setAsynchronousAvatarWrites(asynchronousAvatarWrites);
+
+    // The imported avatars should be saved before the contacts referring to them
+    if (!cancelled) {
+        waitForAvatars(&importedContacts);
+    }
+
+    // Preprocess the imported contacts
+    beginPhase(progress, SeasideImportProgress::Preprocess, importedContacts.count());
+    for (QList<QContact>::iterator it = importedContacts.begin(); !cancelled && it != importedContacts.end(); ++it) {
         builder->preprocessContact(*it);
+        cancelled = !advance(progress);
+    }
+
+    // Merge any duplicates in the import list
+    beginPhase(progress, SeasideImportProgress::Dedupe, importedContacts.count());
+    QList<QContact>::iterator it = importedContacts.begin();
+    while (!cancelled && it != importedContacts.end()) {
         int previousIndex = builder->previousDuplicateIndex(importedContacts, it - importedContacts.begin());
         if (previousIndex != -1) {
             // Combine these duplicate contacts
@@ -76,17 +302,21 @@ QList<QContact> SeasideImport::buildImportContacts(const QList<QVersitDocument>
         } else {
             ++it;
         }
+        cancelled = !advance(progress);
     }
 
     // Build up information about local device contacts, so we can detect matches
     // in order to correctly set the appropriate ContactId in the imported contacts
     // prior to save (thereby ensuring correct add vs update save semantics).
-    builder->buildLocalDeviceContactIndexes();
+    beginPhase(progress, SeasideImportProgress::LocalMatch, importedContacts.count());
+    if (!cancelled) {
+        builder->buildLocalDeviceContactIndexes();
+    }
 
     // Find any imported contacts that match contacts we already have
     QMap<QContactId, int> existingIds;
     it = importedContacts.begin();
-    while (it != importedContacts.end()) {
+    while (!cancelled && it != importedContacts.end()) {
         QContactId existingId = builder->matchingLocalContactId(*it);
         if (!existingId.isNull()) {
             QMap<QContactId, int>::iterator eit = existingIds.find(existingId);
@@ -108,36 +338,46 @@ QList<QContact> SeasideImport::buildImportContacts(const QList<QVersitDocument>
         } else {
             ++it;
         }
+        cancelled = !advance(progress);
     }
 
     int existingCount(existingIds.count());
-    if (existingCount > 0) {
-        // Retrieve all the contacts that we have matches for
-        QContactIdFilter idFilter;
-        idFilter.setIds(existingIds.keys());
-
+    beginPhase(progress, SeasideImportProgress::Merge, existingCount);
+    if (!cancelled && existingCount > 0) {
         QSet<QContactId> modifiedContacts;
         QSet<QContactId> unmodifiedContacts;
         QHash<QContactId, bool> unmodifiedErase;
 
-        foreach (const QContact &contact, builder->manager()->contacts(idFilter & builder->mergeSubsetFilter(), QList<QContactSortOrder>(), basicFetchHint())) {
-            QMap<QContactId, int>::const_iterator it = existingIds.find(contact.id());
-            if (it != existingIds.end()) {
-                // Update the existing version of the contact with any new details
-                QContact &importContact(importedContacts[*it]);
-                bool modified = builder->mergeLocalIntoImport(importContact, contact, &eraseMatch);
-                if (modified) {
-                    modifiedContacts.insert(importContact.id());
+        // Retrieve the contacts that we have matches for, a chunk at a time, so that the
+        // fetch stays within the bound variable limit and each chunk is released once merged
+        const QList<QContactId> ids(existingIds.keys());
+        const QContactFilter subsetFilter(builder->mergeSubsetFilter());
+
+        for (int index = 0; !cancelled && index < ids.count(); index += ExistingFetchChunkSize) {
+            const QList<QContactId> chunkIds(ids.mid(index, ExistingFetchChunkSize));
+            QContactIdFilter idFilter;
+            idFilter.setIds(chunkIds);
+
+            foreach (const QContact &contact, builder->manager()->contacts(idFilter & subsetFilter, QList<QContactSortOrder>(), basicFetchHint())) {
+                QMap<QContactId, int>::const_iterator it = existingIds.find(contact.id());
+                if (it != existingIds.end()) {
+                    // Update the existing version of the contact with any new details
+                    QContact &importContact(importedContacts[*it]);
+                    bool modified = builder->mergeLocalIntoImport(importContact, contact, &eraseMatch);
+                    if (modified) {
+                        modifiedContacts.insert(importContact.id());
+                    } else {
+                        unmodifiedContacts.insert(importContact.id());
+                        unmodifiedErase.insert(importContact.id(), eraseMatch);
+                    }
                 } else {
-                    unmodifiedContacts.insert(importContact.id());
-                    unmodifiedErase.insert(importContact.id(), eraseMatch);
+                    qWarning() << "unable to update existing contact:" << contact.id();
                 }
-            } else {
-                qWarning() << "unable to update existing contact:" << contact.id();
             }
+            cancelled = !advance(progress, chunkIds.count());
         }
 
-        if (!unmodifiedContacts.isEmpty()) {
+        if (!cancelled && !unmodifiedContacts.isEmpty()) {
             QList<QContact>::iterator it = importedContacts.begin();
             while (it != importedContacts.end()) {
                 const QContact &importContact(*it);
@@ -154,6 +394,13 @@ QList<QContact> SeasideImport::buildImportContacts(const QList<QVersitDocument>
         }
     }
 
+    if (cancelled) {
+        qDebug() << "Import cancelled";
+        if (progress)
+            progress->finish();
+        return QList<QContact>();
+    }
+
     if (updatedCount)
         *updatedCount = existingCount;
     if (newCount)
@@ -161,6 +408,9 @@ QList<QContact> SeasideImport::buildImportContacts(const QList<QVersitDocument>
     if (ignoredCount) // duplicates or insignificant updates
         *ignoredCount = details.count() - importedContacts.count();
 
+    if (progress)
+        progress->finish();
+
     return importedContacts;
 }
 
@@ -36,11 +36,60 @@
 #include "seasidecontactbuilder.h"
 
 #include <QContact>
+#include <QObject>
 #include <QVersitDocument>
 
 QTCONTACTS_USE_NAMESPACE
 QTVERSIT_USE_NAMESPACE
 
+class SeasideImportProgressPrivate;
+
+// Reports the progress of an import, and allows it to be cancelled.  The import updates the
+// progress on its own thread; progressChanged() is emitted at the start of each phase, and at
+// most every 100ms within a phase.  The Save phase is reported by the caller which saves the
+// imported contacts, if it wishes.
+
+class CONTACTCACHE_EXPORT SeasideImportProgress : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Phase {
+        Inactive,
+        Parse,
+        Preprocess,
+        Dedupe,
+        LocalMatch,
+        Merge,
+        Save,
+        Finished,
+        Cancelled
+    };
+
+    explicit SeasideImportProgress(QObject *parent = 0);
+    ~SeasideImportProgress();
+
+    Phase phase() const;
+    int itemsProcessed() const;
+    int itemsTotal() const;
+    qreal itemsPerSecond() const;
+
+    void cancel();
+    bool isCancelled() const;
+
+    void beginPhase(Phase phase, int itemsTotal);
+    bool advance(int items = 1);
+    void finish();
+
+signals:
+    void progressChanged();
+
+private:
+    Q_DISABLE_COPY(SeasideImportProgress)
+
+    SeasideImportProgressPrivate *d;
+};
+
 class CONTACTCACHE_EXPORT SeasideImport
 {
     SeasideImport();
@@ -48,6 +97,7 @@ class CONTACTCACHE_EXPORT SeasideImport
 
 public:
     static QList<QContact> buildImportContacts(const QList<QVersitDocument> &details, int *newCount = 0, int *updatedCount = 0, int *ignoredCount = 0, SeasideContactBuilder *builder = 0);
+    static QList<QContact> buildImportContacts(const QList<QVersitDocument> &details, int *newCount, int *updatedCount, int *ignoredCount, SeasideContactBuilder *builder, SeasideImportProgress *progress);
 };
 
 #endif
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include "seasideimportjob.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <QVersitContactImporter>
+#include <QVersitReader>
+
+#include <QtDebug>
+
+QTVERSIT_USE_NAMESPACE
+
+namespace {
+
+// Documents converted together, and converted chunks which may await saving
+const int ChunkDocuments = 100;
+const int MaxPendingChunks = 2;
+
+}
+
+class SeasideImportJobPrivate : public QThread
+{
+public:
+    SeasideImportJobPrivate(SeasideImportJob *job, const QString &path)
+        : q(job)
+        , path(path)
+        , status(SeasideImportJob::Inactive)
+        , cancelled(false)
+        , failed(false)
+        , bytesRead(0)
+        , bytesTotal(0)
+        , documentsRead(0)
+        , contactsSaving(0)
+        , contactsSaved(0)
+        , finishedReported(false)
+    {
+    }
+
+    void run();
+    bool convertChunk(const QByteArray &data, qint64 position);
+
+    SeasideImportJob * const q;
+    const QString path;
+    SeasideImportJob::Status status;
+
+    // Shared with the worker thread
+    mutable QMutex mutex;
+    QWaitCondition chunkTaken;
+    QList<QList<QContact> > chunks;
+    bool cancelled;
+    bool failed;
+    qint64 bytesRead;
+    qint64 bytesTotal;
+    int documentsRead;
+
+    int contactsSaving;
+    int contactsSaved;
+    bool finishedReported;
+};
+
+void SeasideImportJobPrivate::run()
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << Q_FUNC_INFO << "Cannot open " << path;
+        QMutexLocker locker(&mutex);
+        failed = true;
+        return;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        bytesTotal = file.size();
+    }
+
+    // Documents are split at their END:VCARD lines, which can only be found in an ASCII-compatible
+    // encoding; any other file is converted in a single chunk
+    const bool splittable = !file.peek(4).contains('\0');
+
+    QByteArray chunk;
+    int documents = 0;
+    int depth = 0;
+
+    while (!file.atEnd()) {
+        {
+            QMutexLocker locker(&mutex);
+            if (cancelled)
+                return;
+        }
+
+        const QByteArray line(file.readLine());
+        chunk.append(line);
+
+        if (splittable) {
+            const QByteArray tag(line.trimmed().toUpper());
+            if (tag == "BEGIN:VCARD") {
+                ++depth;
+            } else if (tag == "END:VCARD" && depth > 0 && --depth == 0 && ++documents == ChunkDocuments) {
+                if (!convertChunk(chunk, file.pos()))
+                    return;
+
+                chunk.clear();
+                documents = 0;
+            }
+        }
+    }
+
+    if (!chunk.trimmed().isEmpty())
+        convertChunk(chunk, file.pos());
+}
+
+bool SeasideImportJobPrivate::convertChunk(const QByteArray &data, qint64 position)
+{
+    QVersitReader reader(data);
+    reader.startReading();
+    reader.waitForFinished();
+
+    if (reader.error() != QVersitReader::NoError) {
+        qWarning() << Q_FUNC_INFO << "Error reading" << path << ":" << reader.error();
+    }
+
+    const QList<QVersitDocument> documents(reader.results());
+
+    QVersitContactImporter importer;
+    importer.importDocuments(documents);
+    const QList<QContact> contacts(importer.contacts());
+
+    {
+        QMutexLocker locker(&mutex);
+
+        // Wait until the contacts already converted have been taken for saving
+        while (chunks.count() >= MaxPendingChunks && !cancelled)
+            chunkTaken.wait(&mutex);
+
+        if (cancelled)
+            return false;
+
+        bytesRead = position;
+        documentsRead += documents.count();
+        if (!contacts.isEmpty())
+            chunks.append(contacts);
+    }
+
+    QMetaObject::invokeMethod(q, "chunkConverted", Qt::QueuedConnection);
+    return true;
+}
+
+SeasideImportJob::SeasideImportJob(const QString &path, QObject *parent)
+    : QObject(parent)
+    , d(new SeasideImportJobPrivate(this, path))
+{
+    connect(d, SIGNAL(finished()), this, SLOT(readingFinished()));
+}
+
+SeasideImportJob::~SeasideImportJob()
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->cancelled = true;
+        d->chunkTaken.wakeAll();
+    }
+
+    d->wait();
+    delete d;
+}
+
+QString SeasideImportJob::path() const
+{
+    return d->path;
+}
+
+SeasideImportJob::Status SeasideImportJob::status() const
+{
+    return d->status;
+}
+
+qint64 SeasideImportJob::bytesRead() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->bytesRead;
+}
+
+qint64 SeasideImportJob::bytesTotal() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->bytesTotal;
+}
+
+int SeasideImportJob::documentsRead() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->documentsRead;
+}
+
+int SeasideImportJob::contactsSaved() const
+{
+    return d->contactsSaved;
+}
+
+void SeasideImportJob::start()
+{
+    if (d->status != Inactive)
+        return;
+
+    d->status = Active;
+    d->start(QThread::LowPriority);
+}
+
+void SeasideImportJob::cancel()
+{
+    if (d->status != Active)
+        return;
+
+    {
+        QMutexLocker locker(&d->mutex);
+        d->cancelled = true;
+        d->chunks.clear();
+        d->chunkTaken.wakeAll();
+    }
+
+    d->status = Cancelled;
+    emit progressChanged();
+
+    checkFinished();
+}
+
+QList<QContact> SeasideImportJob::takeContacts()
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->chunks.isEmpty())
+        return QList<QContact>();
+
+    const QList<QContact> contacts(d->chunks.takeFirst());
+    d->chunkTaken.wakeAll();
+
+    d->contactsSaving += contacts.count();
+    return contacts;
+}
+
+bool SeasideImportJob::hasPendingContacts() const
+{
+    QMutexLocker locker(&d->mutex);
+    return !d->chunks.isEmpty();
+}
+
+void SeasideImportJob::contactsSaveFinished(int count, int errorCount)
+{
+    d->contactsSaving -= count;
+    d->contactsSaved += count - errorCount;
+    emit progressChanged();
+
+    checkFinished();
+}
+
+void SeasideImportJob::chunkConverted()
+{
+    if (d->status != Active)
+        return;
+
+    emit progressChanged();
+    emit contactsAvailable();
+}
+
+void SeasideImportJob::readingFinished()
+{
+    bool failed;
+    {
+        QMutexLocker locker(&d->mutex);
+        failed = d->failed;
+    }
+
+    if (failed && d->status == Active)
+        d->status = Error;
+
+    checkFinished();
+}
+
+void SeasideImportJob::checkFinished()
+{
+    if (d->finishedReported || d->isRunning() || d->contactsSaving > 0 || hasPendingContacts())
+        return;
+
+    if (d->status == Active)
+        d->status = Finished;
+
+    d->finishedReported = true;
+    emit progressChanged();
+    emit finished();
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#ifndef SEASIDEIMPORTJOB_H
+#define SEASIDEIMPORTJOB_H
+
+#include "contactcacheexport.h"
+
+#include <QContact>
+#include <QObject>
+#include <QString>
+
+QTCONTACTS_USE_NAMESPACE
+
+class SeasideImportJobPrivate;
+
+// Imports the contacts of a vCard file without blocking the calling thread.  The file is read
+// and its documents converted to contacts on a worker thread, in chunks of a bounded number of
+// documents; the worker waits while too many converted chunks are pending, so the memory used
+// does not depend on the size of the file.  The chunks are taken by SeasideCache and saved in
+// turn, each by its own save request.
+
+class CONTACTCACHE_EXPORT SeasideImportJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Status {
+        Inactive,
+        Active,
+        Finished,
+        Cancelled,
+        Error
+    };
+
+    explicit SeasideImportJob(const QString &path, QObject *parent = 0);
+    ~SeasideImportJob();
+
+    QString path() const;
+    Status status() const;
+
+    qint64 bytesRead() const;
+    qint64 bytesTotal() const;
+    int documentsRead() const;
+    int contactsSaved() const;
+
+    void start();
+    void cancel();
+
+    // Returns the next converted chunk of contacts, or an empty list if none is pending
+    QList<QContact> takeContacts();
+    bool hasPendingContacts() const;
+
+    // Reports that the save request for a chunk returned by takeContacts() has finished
+    void contactsSaveFinished(int count, int errorCount);
+
+signals:
+    void contactsAvailable();
+    void progressChanged();
+    void finished();
+
+private slots:
+    void chunkConverted();
+    void readingFinished();
+
+private:
+    void checkFinished();
+
+    Q_DISABLE_COPY(SeasideImportJob)
+
+    SeasideImportJobPrivate *d;
+};
+
+#endif
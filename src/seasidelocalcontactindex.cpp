@@ -0,0 +1,532 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidelocalcontactindex.h"
+
+#include <QContactChangeLogFilter>
+#include <QContactDetailFilter>
+#include <QContactFetchHint>
+#include <QContactGuid>
+#include <QContactIdFilter>
+#include <QContactName>
+#include <QContactNickname>
+#include <QContactSortOrder>
+#include <QContactSyncTarget>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <QStringList>
+
+#include <QtDebug>
+
+namespace {
+
+const quint32 indexMagic = 0x4c434958; // 'LCIX'
+const quint32 indexVersion = 1;
+
+struct IndexEntry
+{
+    QString guid;
+    QString name;
+    QStringList nicknames;
+};
+
+QContactFetchHint indexFetchHint()
+{
+    QContactFetchHint fetchHint;
+
+    fetchHint.setOptimizationHints(QContactFetchHint::NoRelationships |
+                                   QContactFetchHint::NoActionPreferences |
+                                   QContactFetchHint::NoBinaryBlobs);
+    fetchHint.setDetailTypesHint(QList<QContactDetail::DetailType>() << QContactName::Type << QContactNickname::Type << QContactGuid::Type);
+
+    return fetchHint;
+}
+
+bool nameIsEmpty(const QContactName &name)
+{
+    if (name.isEmpty())
+        return true;
+
+    return (name.prefix().isEmpty() &&
+            name.firstName().isEmpty() &&
+            name.middleName().isEmpty() &&
+            name.lastName().isEmpty() &&
+            name.suffix().isEmpty());
+}
+
+// Maps each key to the most recently indexed contact holding it, falling back to an
+// earlier holder when that contact is removed
+struct KeyIndex
+{
+    void insert(const QString &key, const QContactId &id)
+    {
+        current.insert(key, id);
+        holders[key].append(id);
+    }
+
+    void remove(const QString &key, const QContactId &id)
+    {
+        QHash<QString, QList<QContactId> >::iterator it = holders.find(key);
+        if (it == holders.end())
+            return;
+
+        it->removeOne(id);
+        if (it->isEmpty()) {
+            holders.erase(it);
+            current.remove(key);
+        } else {
+            current.insert(key, it->last());
+        }
+    }
+
+    void clear()
+    {
+        current.clear();
+        holders.clear();
+    }
+
+    QHash<QString, QContactId> current;
+    QHash<QString, QList<QContactId> > holders;
+};
+
+}
+
+class SeasideLocalContactIndexPrivate
+{
+public:
+    SeasideLocalContactIndexPrivate(QContactManager *manager, const QContactFilter &filter, const QString &path)
+        : manager(manager)
+        , filter(filter)
+        , path(path)
+        , populated(false)
+        , resetRequired(false)
+    {
+    }
+
+    void insert(const QContactId &id, const IndexEntry &entry);
+    void insert(const QContact &contact);
+    void remove(const QContactId &id);
+    void clear();
+
+    bool populate();
+    bool update(const QList<QContactId> &ids);
+    bool restore();
+    void store();
+
+    QContactManager * const manager;
+    const QContactFilter filter;
+    const QString path;
+
+    // Held while the index is read or refreshed
+    mutable QMutex mutex;
+    QHash<QContactId, IndexEntry> entries;
+    KeyIndex guids;
+    KeyIndex names;
+    QMap<QContactId, QString> contactNames;
+    KeyIndex nicknames;
+    QDateTime syncTime;
+    bool populated;
+
+    // Reported by the manager since the last refresh
+    QMutex pendingMutex;
+    QSet<QContactId> pendingIds;
+    bool resetRequired;
+};
+
+void SeasideLocalContactIndexPrivate::insert(const QContactId &id, const IndexEntry &entry)
+{
+    entries.insert(id, entry);
+
+    if (!entry.guid.isEmpty()) {
+        guids.insert(entry.guid, id);
+    }
+    if (!entry.name.isEmpty()) {
+        names.insert(entry.name, id);
+        contactNames.insert(id, entry.name);
+    }
+    foreach (const QString &nickname, entry.nicknames.toSet()) {
+        nicknames.insert(nickname, id);
+    }
+}
+
+void SeasideLocalContactIndexPrivate::insert(const QContact &contact)
+{
+    IndexEntry entry;
+    entry.guid = contact.detail<QContactGuid>().guid();
+    entry.name = SeasideLocalContactIndex::contactNameString(contact);
+    foreach (const QContactNickname &nick, contact.details<QContactNickname>()) {
+        entry.nicknames.append(nick.nickname());
+    }
+
+    insert(contact.id(), entry);
+}
+
+void SeasideLocalContactIndexPrivate::remove(const QContactId &id)
+{
+    QHash<QContactId, IndexEntry>::iterator it = entries.find(id);
+    if (it == entries.end())
+        return;
+
+    const IndexEntry &entry(*it);
+    if (!entry.guid.isEmpty()) {
+        guids.remove(entry.guid, id);
+    }
+    if (!entry.name.isEmpty()) {
+        names.remove(entry.name, id);
+        contactNames.remove(id);
+    }
+    foreach (const QString &nickname, entry.nicknames.toSet()) {
+        nicknames.remove(nickname, id);
+    }
+
+    entries.erase(it);
+}
+
+void SeasideLocalContactIndexPrivate::clear()
+{
+    entries.clear();
+    guids.clear();
+    names.clear();
+    contactNames.clear();
+    nicknames.clear();
+}
+
+bool SeasideLocalContactIndexPrivate::populate()
+{
+    clear();
+
+    const QList<QContact> contacts(manager->contacts(filter, QList<QContactSortOrder>(), indexFetchHint()));
+    if (manager->error() != QContactManager::NoError) {
+        qWarning() << "Unable to populate local contact index:" << manager->error();
+        return false;
+    }
+
+    foreach (const QContact &contact, contacts) {
+        insert(contact);
+    }
+
+    return true;
+}
+
+bool SeasideLocalContactIndexPrivate::update(const QList<QContactId> &ids)
+{
+    QContactIdFilter idFilter;
+    idFilter.setIds(ids);
+
+    const QList<QContact> contacts(manager->contacts(idFilter & filter, QList<QContactSortOrder>(), indexFetchHint()));
+    if (manager->error() != QContactManager::NoError) {
+        qWarning() << "Unable to update local contact index:" << manager->error();
+        return false;
+    }
+
+    // Any contact not fetched has been removed, or no longer matches the filter
+    foreach (const QContactId &id, ids) {
+        remove(id);
+    }
+    foreach (const QContact &contact, contacts) {
+        insert(contact);
+    }
+
+    return true;
+}
+
+bool SeasideLocalContactIndexPrivate::restore()
+{
+    if (path.isEmpty())
+        return false;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    stream >> magic >> version;
+    if (magic != indexMagic || version != indexVersion)
+        return false;
+
+    QString managerUri;
+    QDateTime storedTime;
+    quint32 count = 0;
+    stream >> managerUri >> storedTime >> count;
+    if (stream.status() != QDataStream::Ok || managerUri != manager->managerUri() || !storedTime.isValid())
+        return false;
+
+    // Contacts changed since the index was stored can only be found if the manager records modifications
+    QContactChangeLogFilter changedFilter(QContactChangeLogFilter::EventChanged);
+    changedFilter.setSince(storedTime);
+    if (!manager->isFilterSupported(changedFilter))
+        return false;
+
+    QHash<QContactId, IndexEntry> stored;
+    for ( ; count > 0 && stream.status() == QDataStream::Ok; --count) {
+        QString id;
+        IndexEntry entry;
+        stream >> id >> entry.guid >> entry.name >> entry.nicknames;
+        stored.insert(QContactId::fromString(id), entry);
+    }
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    // Fetching only the ids of the indexed contacts finds those added and removed in the meantime
+    const QList<QContactId> currentIds(manager->contactIds(filter));
+    const QList<QContactId> changedIds(manager->contactIds(changedFilter));
+    if (manager->error() != QContactManager::NoError)
+        return false;
+
+    clear();
+
+    QList<QContactId> fetchIds;
+    foreach (const QContactId &id, currentIds) {
+        QHash<QContactId, IndexEntry>::const_iterator it = stored.constFind(id);
+        if (it != stored.constEnd()) {
+            insert(id, *it);
+        } else {
+            fetchIds.append(id);
+        }
+    }
+    foreach (const QContactId &id, changedIds) {
+        if (entries.contains(id))
+            fetchIds.append(id);
+    }
+
+    if (!fetchIds.isEmpty() && !update(fetchIds))
+        return false;
+
+    qDebug() << "Restored local contact index of" << entries.count() << "contacts, fetched" << fetchIds.count();
+    return true;
+}
+
+void SeasideLocalContactIndexPrivate::store()
+{
+    if (path.isEmpty())
+        return;
+
+    if (!QDir().mkpath(QFileInfo(path).path())) {
+        qWarning() << "Unable to create local contact index directory:" << path;
+        return;
+    }
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Unable to write local contact index:" << path;
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << indexMagic << indexVersion << manager->managerUri() << syncTime;
+
+    stream << static_cast<quint32>(entries.count());
+    for (QHash<QContactId, IndexEntry>::const_iterator it = entries.constBegin(), end = entries.constEnd(); it != end; ++it) {
+        stream << it.key().toString() << it->guid << it->name << it->nicknames;
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Unable to commit local contact index:" << path;
+    }
+}
+
+SeasideLocalContactIndex::SeasideLocalContactIndex(QContactManager *manager, const QContactFilter &filter, const QString &path, QObject *parent)
+    : QObject(parent)
+    , d(new SeasideLocalContactIndexPrivate(manager, filter, path))
+{
+    // The reported ids are only recorded, so they can be delivered on any thread
+    connect(manager, SIGNAL(dataChanged()), this, SLOT(dataChanged()), Qt::DirectConnection);
+    connect(manager, SIGNAL(contactsAdded(QList<QContactId>)),
+            this, SLOT(contactsModified(QList<QContactId>)), Qt::DirectConnection);
+    connect(manager, SIGNAL(contactsChanged(QList<QContactId>)),
+            this, SLOT(contactsModified(QList<QContactId>)), Qt::DirectConnection);
+    connect(manager, SIGNAL(contactsRemoved(QList<QContactId>)),
+            this, SLOT(contactsModified(QList<QContactId>)), Qt::DirectConnection);
+}
+
+SeasideLocalContactIndex::~SeasideLocalContactIndex()
+{
+    delete d;
+}
+
+QContactManager *SeasideLocalContactIndex::manager() const
+{
+    return d->manager;
+}
+
+QContactFilter SeasideLocalContactIndex::filter() const
+{
+    return d->filter;
+}
+
+QString SeasideLocalContactIndex::path() const
+{
+    return d->path;
+}
+
+/*
+ * Brings the index up to date with the content of the manager.
+ *
+ * The first refresh restores the stored index, if there is one, and fetches
+ * only the contacts modified since it was stored; otherwise every matching
+ * contact is fetched.  Later refreshes fetch only the contacts reported by
+ * the manager in the meantime.
+ */
+void SeasideLocalContactIndex::refresh()
+{
+    QMutexLocker locker(&d->mutex);
+
+    QSet<QContactId> pendingIds;
+    bool reset = false;
+    {
+        QMutexLocker pendingLocker(&d->pendingMutex);
+        pendingIds.swap(d->pendingIds);
+        reset = d->resetRequired;
+        d->resetRequired = false;
+    }
+
+    // Any modification from this point is reported to us, and found by the next refresh
+    const QDateTime refreshTime(QDateTime::currentDateTimeUtc());
+
+    if (!d->populated || reset) {
+        if ((reset || !d->restore()) && !d->populate()) {
+            d->populated = false;
+            return;
+        }
+        d->populated = true;
+    } else if (pendingIds.isEmpty()) {
+        return;
+    } else if (!d->update(pendingIds.toList())) {
+        QMutexLocker pendingLocker(&d->pendingMutex);
+        d->pendingIds.unite(pendingIds);
+        return;
+    }
+
+    d->syncTime = refreshTime;
+    d->store();
+}
+
+QHash<QString, QContactId> SeasideLocalContactIndex::guids() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->guids.current;
+}
+
+QHash<QString, QContactId> SeasideLocalContactIndex::names() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->names.current;
+}
+
+QMap<QContactId, QString> SeasideLocalContactIndex::contactNames() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->contactNames;
+}
+
+QHash<QString, QContactId> SeasideLocalContactIndex::nicknames() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->nicknames.current;
+}
+
+/*
+ * Returns the string by which the name of \a contact is matched,
+ * or an empty string if the contact has no name.
+ */
+QString SeasideLocalContactIndex::contactNameString(const QContact &contact)
+{
+    QStringList details;
+    QContactName name(contact.detail<QContactName>());
+    if (nameIsEmpty(name))
+        return QString();
+
+    details.append(name.prefix());
+    details.append(name.firstName());
+    details.append(name.middleName());
+    details.append(name.lastName());
+    details.append(name.suffix());
+    return details.join(QChar::fromLatin1('|'));
+}
+
+/*
+ * Returns a filter matching the contacts local to the device.
+ */
+QContactFilter SeasideLocalContactIndex::localContactFilter()
+{
+    // Contacts that are local to the device have sync target 'local' or 'was_local' or 'bluetooth'
+    QContactDetailFilter filterLocal, filterWasLocal, filterBluetooth;
+    filterLocal.setDetailType(QContactSyncTarget::Type, QContactSyncTarget::FieldSyncTarget);
+    filterWasLocal.setDetailType(QContactSyncTarget::Type, QContactSyncTarget::FieldSyncTarget);
+    filterBluetooth.setDetailType(QContactSyncTarget::Type, QContactSyncTarget::FieldSyncTarget);
+    filterLocal.setValue(QString::fromLatin1("local"));
+    filterWasLocal.setValue(QString::fromLatin1("was_local"));
+    filterBluetooth.setValue(QString::fromLatin1("bluetooth"));
+
+    return filterLocal | filterWasLocal | filterBluetooth;
+}
+
+/*
+ * Marks the contacts identified by \a ids as modified, so that the next refresh
+ * fetches them again.
+ *
+ * The manager reports modifications asynchronously, so a caller which saves or
+ * removes contacts should invalidate them once the operation has completed;
+ * otherwise a refresh made before the report arrives would not include them.
+ */
+void SeasideLocalContactIndex::invalidate(const QList<QContactId> &ids)
+{
+    QMutexLocker locker(&d->pendingMutex);
+    foreach (const QContactId &id, ids) {
+        d->pendingIds.insert(id);
+    }
+}
+
+void SeasideLocalContactIndex::contactsModified(const QList<QContactId> &ids)
+{
+    invalidate(ids);
+}
+
+void SeasideLocalContactIndex::dataChanged()
+{
+    QMutexLocker locker(&d->pendingMutex);
+    d->resetRequired = true;
+    d->pendingIds.clear();
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#ifndef SEASIDELOCALCONTACTINDEX_H
+#define SEASIDELOCALCONTACTINDEX_H
+
+#include "contactcacheexport.h"
+
+#include <QContact>
+#include <QContactFilter>
+#include <QContactManager>
+
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QString>
+
+QTCONTACTS_USE_NAMESPACE
+
+class SeasideLocalContactIndexPrivate;
+
+// Indexes the GUID, name and nicknames of the contacts matching a filter, which are used to find
+// the existing versions of imported contacts.  The index is populated once and then kept up to
+// date from the change signals of the manager: refresh() fetches only the contacts reported as
+// added or changed since the previous refresh.  If a path is given, the index is stored there
+// and restored by the next process, which then only fetches the contacts modified in between.
+
+class CONTACTCACHE_EXPORT SeasideLocalContactIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    SeasideLocalContactIndex(QContactManager *manager, const QContactFilter &filter, const QString &path = QString(), QObject *parent = 0);
+    ~SeasideLocalContactIndex();
+
+    QContactManager *manager() const;
+    QContactFilter filter() const;
+    QString path() const;
+
+    // Brings the index up to date with the content of the manager
+    void refresh();
+
+    // Ensures that the next refresh fetches these contacts
+    void invalidate(const QList<QContactId> &ids);
+
+    QHash<QString, QContactId> guids() const;
+    QHash<QString, QContactId> names() const;
+    QMap<QContactId, QString> contactNames() const;
+    QHash<QString, QContactId> nicknames() const;
+
+    static QString contactNameString(const QContact &contact);
+    static QContactFilter localContactFilter();
+
+private slots:
+    void contactsModified(const QList<QContactId> &ids);
+    void dataChanged();
+
+private:
+    Q_DISABLE_COPY(SeasideLocalContactIndex)
+
+    SeasideLocalContactIndexPrivate *d;
+};
+
+#endif
@@ -0,0 +1,389 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidephonenumberindex.h"
+
+#include <qtcontacts-extensions.h>
+
+#include <QHash>
+#include <QVector>
+
+#include <phonenumbers/phonenumberutil.h>
+
+using ::i18n::phonenumbers::PhoneNumber;
+using ::i18n::phonenumbers::PhoneNumberUtil;
+
+namespace {
+
+QString::const_iterator firstDtmfChar(QString::const_iterator it, QString::const_iterator end)
+{
+    static const QString dtmfChars(QString::fromLatin1("pPwWxX#*"));
+
+    for ( ; it != end; ++it) {
+        if (dtmfChars.contains(*it))
+            return it;
+    }
+    return end;
+}
+
+const int ExactMatch = 100;
+
+int matchLength(const QString &lhs, const QString &rhs)
+{
+    if (lhs.isEmpty() || rhs.isEmpty())
+        return 0;
+
+    QString::const_iterator lbegin = lhs.constBegin(), lend = lhs.constEnd();
+    QString::const_iterator rbegin = rhs.constBegin(), rend = rhs.constEnd();
+
+    // Do these numbers contain DTMF elements?
+    QString::const_iterator ldtmf = firstDtmfChar(lbegin, lend);
+    QString::const_iterator rdtmf = firstDtmfChar(rbegin, rend);
+
+    QString::const_iterator lit, rit;
+    bool processDtmf = false;
+    int matchLength = 0;
+
+    if ((ldtmf != lbegin) && (rdtmf != rbegin)) {
+        // Start match length calculation at the last non-DTMF digit
+        lit = ldtmf - 1;
+        rit = rdtmf - 1;
+
+        while (*lit == *rit) {
+            ++matchLength;
+
+            --lit;
+            --rit;
+            if ((lit == lbegin) || (rit == rbegin)) {
+                if (*lit == *rit) {
+                    ++matchLength;
+
+                    if ((lit == lbegin) && (rit == rbegin)) {
+                        // We have a complete, exact match - this must be the best match
+                        return ExactMatch;
+                    } else {
+                        // We matched all of one number - continue looking in the DTMF part
+                        processDtmf = true;
+                    }
+                }
+                break;
+            }
+        }
+    } else {
+        // Process the DTMF section for a match
+        processDtmf = true;
+    }
+
+    // Have we got a match?
+    if ((matchLength >= QtContactsSqliteExtensions::DefaultMaximumPhoneNumberCharacters) ||
+        processDtmf) {
+        // See if the match continues into the DTMF area
+        QString::const_iterator lit = ldtmf;
+        QString::const_iterator rit = rdtmf;
+        for ( ; (lit != lend) && (rit != rend); ++lit, ++rit) {
+            if ((*lit).toLower() != (*rit).toLower())
+                break;
+            ++matchLength;
+        }
+    }
+
+    return matchLength;
+}
+
+struct Entry
+{
+    quint32 iid;
+    QString normalizedNumber;
+    std::string number;
+    PhoneNumber parsed;
+    PhoneNumberUtil::ErrorType parseError;
+};
+
+struct Node
+{
+    Node() : character(0), child(-1), sibling(-1) {}
+
+    ushort character;
+    int child;
+    int sibling;
+    QVector<Entry> entries;
+};
+
+}
+
+class SeasidePhoneNumberIndexPrivate
+{
+public:
+    SeasidePhoneNumberIndexPrivate() : nodes(1), count(0) {}
+
+    int findNode(const QString &key, QVector<int> *path = 0) const;
+    int insertNode(const QString &key);
+    void pruneNodes(const QVector<int> &path);
+
+    PhoneNumberUtil::MatchType match(const Entry &entry, const std::string &number,
+                                     const PhoneNumber &parsed, PhoneNumberUtil::ErrorType parseError) const;
+
+    QVector<Node> nodes;
+    QVector<int> freeNodes;
+    QHash<quint32, QHash<QString, int> > contactNumbers; // the number of keys indexing each number
+    int count;
+};
+
+int SeasidePhoneNumberIndexPrivate::findNode(const QString &key, QVector<int> *path) const
+{
+    if (key.isEmpty())
+        return -1;
+
+    // Numbers are most distinct at their ends, so walk the key in reverse
+    int node = 0;
+    for (int i = key.length() - 1; i >= 0 && node != -1; --i) {
+        const ushort character = key.at(i).unicode();
+
+        if (path)
+            path->append(node);
+
+        int child = nodes.at(node).child;
+        while (child != -1 && nodes.at(child).character != character)
+            child = nodes.at(child).sibling;
+        node = child;
+    }
+    return node;
+}
+
+int SeasidePhoneNumberIndexPrivate::insertNode(const QString &key)
+{
+    int node = 0;
+    for (int i = key.length() - 1; i >= 0; --i) {
+        const ushort character = key.at(i).unicode();
+
+        int child = nodes.at(node).child;
+        while (child != -1 && nodes.at(child).character != character)
+            child = nodes.at(child).sibling;
+
+        if (child == -1) {
+            // Reuse the space of any pruned node
+            if (!freeNodes.isEmpty()) {
+                child = freeNodes.takeLast();
+            } else {
+                child = nodes.count();
+                nodes.append(Node());
+            }
+            nodes[child].character = character;
+            nodes[child].sibling = nodes.at(node).child;
+            nodes[node].child = child;
+        }
+        node = child;
+    }
+    return node;
+}
+
+void SeasidePhoneNumberIndexPrivate::pruneNodes(const QVector<int> &path)
+{
+    // Unlink each node from the end of the path which no longer leads to any entry
+    for (int i = path.count() - 1; i > 0; --i) {
+        const int node = path.at(i);
+        if (!nodes.at(node).entries.isEmpty() || nodes.at(node).child != -1)
+            return;
+
+        const int parent = path.at(i - 1);
+        if (nodes.at(parent).child == node) {
+            nodes[parent].child = nodes.at(node).sibling;
+        } else {
+            int previous = nodes.at(parent).child;
+            while (nodes.at(previous).sibling != node)
+                previous = nodes.at(previous).sibling;
+            nodes[previous].sibling = nodes.at(node).sibling;
+        }
+
+        nodes[node] = Node();
+        freeNodes.append(node);
+    }
+}
+
+PhoneNumberUtil::MatchType SeasidePhoneNumberIndexPrivate::match(const Entry &entry, const std::string &number,
+                                                                 const PhoneNumber &parsed, PhoneNumberUtil::ErrorType parseError) const
+{
+    // Equivalent to IsNumberMatchWithTwoStrings(number, entry.number), without parsing
+    // either number again where the parsed form is already known
+    PhoneNumberUtil *util = PhoneNumberUtil::GetInstance();
+
+    if (parseError == PhoneNumberUtil::NO_PARSING_ERROR) {
+        if (entry.parseError == PhoneNumberUtil::NO_PARSING_ERROR)
+            return util->IsNumberMatch(parsed, entry.parsed);
+        if (entry.parseError == PhoneNumberUtil::INVALID_COUNTRY_CODE_ERROR)
+            return util->IsNumberMatchWithOneString(parsed, entry.number);
+    } else if (parseError == PhoneNumberUtil::INVALID_COUNTRY_CODE_ERROR) {
+        if (entry.parseError == PhoneNumberUtil::NO_PARSING_ERROR)
+            return util->IsNumberMatchWithOneString(entry.parsed, number);
+        if (entry.parseError == PhoneNumberUtil::INVALID_COUNTRY_CODE_ERROR)
+            return util->IsNumberMatchWithTwoStrings(number, entry.number);
+    }
+
+    return PhoneNumberUtil::INVALID_NUMBER;
+}
+
+SeasidePhoneNumberIndex::SeasidePhoneNumberIndex()
+    : d(new SeasidePhoneNumberIndexPrivate)
+{
+}
+
+SeasidePhoneNumberIndex::~SeasidePhoneNumberIndex()
+{
+    delete d;
+}
+
+int SeasidePhoneNumberIndex::count() const
+{
+    return d->count;
+}
+
+bool SeasidePhoneNumberIndex::contains(const QString &key) const
+{
+    const int node = d->findNode(key);
+    return node != -1 && !d->nodes.at(node).entries.isEmpty();
+}
+
+void SeasidePhoneNumberIndex::insert(const QString &key, const QString &normalizedNumber, quint32 iid)
+{
+    if (key.isEmpty())
+        return;
+
+    QVector<Entry> &entries(d->nodes[d->insertNode(key)].entries);
+    for (const Entry &entry : entries) {
+        if (entry.iid == iid && entry.normalizedNumber == normalizedNumber)
+            return;
+    }
+
+    Entry entry;
+    entry.iid = iid;
+    entry.normalizedNumber = normalizedNumber;
+    entry.number = normalizedNumber.toStdString();
+    entry.parseError = PhoneNumberUtil::GetInstance()->Parse(entry.number, "ZZ", &entry.parsed);
+    entries.append(entry);
+
+    ++d->contactNumbers[iid][normalizedNumber];
+    ++d->count;
+}
+
+void SeasidePhoneNumberIndex::remove(const QString &key, const QString &normalizedNumber, quint32 iid)
+{
+    QVector<int> path;
+    const int node = d->findNode(key, &path);
+    if (node == -1)
+        return;
+
+    QVector<Entry> &entries(d->nodes[node].entries);
+    for (int i = entries.count() - 1; i >= 0; --i) {
+        if (entries.at(i).iid == iid && entries.at(i).normalizedNumber == normalizedNumber) {
+            entries.remove(i);
+            --d->count;
+
+            QHash<quint32, QHash<QString, int> >::iterator numbers = d->contactNumbers.find(iid);
+            if (--(*numbers)[normalizedNumber] == 0) {
+                numbers->remove(normalizedNumber);
+                if (numbers->isEmpty())
+                    d->contactNumbers.erase(numbers);
+            }
+        }
+    }
+
+    if (entries.isEmpty()) {
+        path.append(node);
+        d->pruneNodes(path);
+    }
+}
+
+void SeasidePhoneNumberIndex::clear()
+{
+    d->nodes = QVector<Node>(1);
+    d->freeNodes.clear();
+    d->contactNumbers.clear();
+    d->count = 0;
+}
+
+SeasidePhoneNumberIndex::Match SeasidePhoneNumberIndex::find(const QString &key, const QString &normalizedNumber) const
+{
+    Match result;
+
+    const int node = d->findNode(key);
+    if (node == -1)
+        return result;
+
+    const QVector<Entry> &entries(d->nodes.at(node).entries);
+    if (entries.isEmpty())
+        return result;
+
+    // Bypass libphonenumber if the numbers match exactly
+    for (const Entry &entry : entries) {
+        if (entry.normalizedNumber == normalizedNumber) {
+            result.iid = entry.iid;
+            result.exact = true;
+            return result;
+        }
+    }
+
+    const std::string number(normalizedNumber.toStdString());
+    PhoneNumber parsed;
+    const PhoneNumberUtil::ErrorType parseError = PhoneNumberUtil::GetInstance()->Parse(number, "ZZ", &parsed);
+
+    int bestMatchLength = 0;
+    for (const Entry &entry : entries) {
+        switch (d->match(entry, number, parsed, parseError)) {
+        case PhoneNumberUtil::EXACT_MATCH:
+            // This is the optimal outcome
+            result.iid = entry.iid;
+            result.exact = true;
+            return result;
+        case PhoneNumberUtil::NSN_MATCH:
+        case PhoneNumberUtil::SHORT_NSN_MATCH: {
+            // The NSN (national significant number) might match; prefer the longest match
+            // Example: if +36701234567 is calling, then 1234567 is an NSN match
+            const int length = matchLength(entry.normalizedNumber, normalizedNumber);
+            if (length > bestMatchLength) {
+                bestMatchLength = length;
+                result.iid = entry.iid;
+            }
+            break;
+        }
+        default:
+            // Either couldn't parse the number or it was NO_MATCH, ignore it
+            break;
+        }
+    }
+
+    return result;
+}
+
+QStringList SeasidePhoneNumberIndex::normalizedNumbers(quint32 iid) const
+{
+    return d->contactNumbers.value(iid).keys();
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#ifndef SEASIDEPHONENUMBERINDEX_H
+#define SEASIDEPHONENUMBERINDEX_H
+
+#include "contactcacheexport.h"
+
+#include <QString>
+#include <QStringList>
+
+class SeasidePhoneNumberIndexPrivate;
+
+// Index of cached phone numbers, held in a trie keyed on the reversed characters of the
+// indexed form of each number (the minimized form, or the complete form including the
+// country code).  Each entry holds the normalized number already parsed by libphonenumber,
+// so that a lookup requires no further normalization of the cached numbers.
+
+class CONTACTCACHE_EXPORT SeasidePhoneNumberIndex
+{
+public:
+    struct Match
+    {
+        Match() : iid(0), exact(false) {}
+
+        quint32 iid;
+        bool exact;
+    };
+
+    SeasidePhoneNumberIndex();
+    ~SeasidePhoneNumberIndex();
+
+    int count() const;
+    bool contains(const QString &key) const;
+
+    void insert(const QString &key, const QString &normalizedNumber, quint32 iid);
+    void remove(const QString &key, const QString &normalizedNumber, quint32 iid);
+    void clear();
+
+    // Returns the contact whose number indexed under key best matches the normalized number
+    Match find(const QString &key, const QString &normalizedNumber) const;
+
+    // Returns the normalized numbers indexed for the contact, under any key
+    QStringList normalizedNumbers(quint32 iid) const;
+
+private:
+    Q_DISABLE_COPY(SeasidePhoneNumberIndex)
+
+    SeasidePhoneNumberIndexPrivate *d;
+};
+
+#endif
@@ -36,15 +36,118 @@
 #include <QContactOnlineAccount>
 #include <QContactPresence>
 #include <QContactSyncTarget>
+#include <QBuffer>
 #include <QCryptographicHash>
 #include <QDir>
 #include <QImage>
+#include <QImageReader>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include <qtcontacts-extensions.h>
 
 namespace {
 
-QContactAvatar avatarFromPhotoProperty(const QVersitProperty &property)
+bool saveAvatarImage(const QString &path, const QByteArray &data)
+{
+    QImage img;
+    if (!img.loadFromData(data)) {
+        qWarning() << "Failed to load avatar image from vCard PHOTO data";
+        return false;
+    }
+
+    // Write to a temporary file first, so that the image is never seen partially written
+    const QString temporaryPath(path + QString::fromLatin1(".tmp"));
+    if (!img.save(temporaryPath, "JPG") || !QFile::rename(temporaryPath, path)) {
+        qWarning() << "Failed to save avatar image from vCard PHOTO data to" << path;
+        QFile::remove(temporaryPath);
+        return false;
+    }
+
+    qWarning() << "Successfully saved avatar image from vCard PHOTO data to" << path;
+    return true;
+}
+
+// Avatar images are decoded and re-encoded by a pool of threads, so that importing does not
+// wait for them; each image is saved once, however many contacts share it
+class AvatarWriter
+{
+public:
+    AvatarWriter()
+    {
+        static const int MaxThreads = 2;
+        pool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, MaxThreads));
+    }
+
+    void write(const QString &path, const QByteArray &data);
+    void finished(const QString &path);
+    void waitFor(const QStringList &paths);
+
+    QMutex mutex;
+    QWaitCondition writeFinished;
+    QSet<QString> pendingPaths;
+    QThreadPool pool;
+};
+
+Q_GLOBAL_STATIC(AvatarWriter, avatarWriter)
+
+class AvatarTask : public QRunnable
+{
+public:
+    AvatarTask(AvatarWriter *writer, const QString &path, const QByteArray &data)
+        : writer(writer), path(path), data(data)
+    {
+    }
+
+    void run()
+    {
+        saveAvatarImage(path, data);
+        writer->finished(path);
+    }
+
+    AvatarWriter * const writer;
+    const QString path;
+    const QByteArray data;
+};
+
+void AvatarWriter::write(const QString &path, const QByteArray &data)
+{
+    // Bound the image data held in memory by waiting for earlier images to be written
+    static const int MaxPendingWrites = 16;
+
+    QMutexLocker locker(&mutex);
+    if (pendingPaths.contains(path))
+        return;
+
+    while (pendingPaths.count() >= MaxPendingWrites)
+        writeFinished.wait(&mutex);
+
+    pendingPaths.insert(path);
+    pool.start(new AvatarTask(this, path, data));
+}
+
+void AvatarWriter::finished(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    pendingPaths.remove(path);
+    writeFinished.wakeAll();
+}
+
+void AvatarWriter::waitFor(const QStringList &paths)
+{
+    QMutexLocker locker(&mutex);
+    foreach (const QString &path, paths) {
+        while (pendingPaths.contains(path))
+            writeFinished.wait(&mutex);
+    }
+}
+
+QContactAvatar avatarFromPhotoProperty(const QVersitProperty &property, bool asynchronous)
 {
     // if the property is a PHOTO property, store the data to disk
     // and then create an avatar detail which points to it.
@@ -97,37 +200,46 @@ QContactAvatar avatarFromPhotoProperty(const QVersitProperty &property)
         }
     }
 
-    QImage img;
-    bool loaded = img.loadFromData(photoData);
-    if (!loaded) {
-        qWarning() << "Failed to load avatar image from vCard PHOTO data";
-        return QContactAvatar();
-    }
-
     // We will save the avatar image to disk in the system's data location
     // Since we're importing user data, it should not require privileged access
     const QString subdirectory(QString::fromLatin1(".local/share/system/Contacts/avatars"));
     const QString photoDirPath(QDir::home().filePath(subdirectory));
 
-    // create the photo file dir if it doesn't exist.
-    QDir photoDir;
-    if (!photoDir.mkpath(photoDirPath)) {
-        qWarning() << "Failed to create avatar image directory when loading avatar image from vCard PHOTO data";
-        return QContactAvatar();
-    }
-
     // construct the filename of the new avatar image.
     QString photoFilePath = QString::fromLatin1(QCryptographicHash::hash(photoData, QCryptographicHash::Md5).toHex());
     photoFilePath = photoDirPath + QDir::separator() + photoFilePath + QString::fromLatin1(".jpg");
 
-    // save the file to disk
-    bool saved = img.save(photoFilePath);
-    if (!saved) {
-        qWarning() << "Failed to save avatar image from vCard PHOTO data to" << photoFilePath;
-        return QContactAvatar();
+    // The file is named for the hash of the data, so if it exists this image has been saved already
+    if (!asynchronous && avatarWriter.exists()) {
+        // The image may be being saved in the background for another caller
+        avatarWriter()->waitFor(QStringList() << photoFilePath);
     }
+    if (!QFile::exists(photoFilePath)) {
+        if (asynchronous) {
+            // Check that the data is an image, without decoding it; data which cannot be decoded
+            // is only found when the image is written, see waitForAvatarsSaved()
+            QBuffer buffer(&photoData);
+            QImageReader reader(&buffer);
+            if (!reader.canRead()) {
+                qWarning() << "Failed to load avatar image from vCard PHOTO data";
+                return QContactAvatar();
+            }
+        }
 
-    qWarning() << "Successfully saved avatar image from vCard PHOTO data to" << photoFilePath;
+        // create the photo file dir if it doesn't exist.
+        QDir photoDir;
+        if (!photoDir.mkpath(photoDirPath)) {
+            qWarning() << "Failed to create avatar image directory when loading avatar image from vCard PHOTO data";
+            return QContactAvatar();
+        }
+
+        // save the file to disk
+        if (asynchronous) {
+            avatarWriter()->write(photoFilePath, photoData);
+        } else if (!saveAvatarImage(photoFilePath, photoData)) {
+            return QContactAvatar();
+        }
+    }
 
     // save the avatar detail - TODO: mark the avatar as "owned by the contact" (remove on delete)
     QContactAvatar newAvatar;
@@ -137,9 +249,9 @@ QContactAvatar avatarFromPhotoProperty(const QVersitProperty &property)
     return newAvatar;
 }
 
-void processPhoto(const QVersitProperty &property, bool *alreadyProcessed, QList<QContactDetail> * updatedDetails)
+void processPhoto(const QVersitProperty &property, bool asynchronous, bool *alreadyProcessed, QList<QContactDetail> * updatedDetails)
 {
-    QContactAvatar newAvatar = avatarFromPhotoProperty(property);
+    QContactAvatar newAvatar = avatarFromPhotoProperty(property, asynchronous);
     if (!newAvatar.isEmpty()) {
         updatedDetails->append(newAvatar);
         *alreadyProcessed = true;
@@ -242,7 +354,10 @@ void ignoreDetail(const QContactSyncTarget &detail, QSet<int> * processedFields,
 class SeasidePropertyHandlerPrivate
 {
 public:
+    SeasidePropertyHandlerPrivate() : m_asynchronousAvatarWrites(false) {}
+
     QSet<QContactDetail::DetailType> m_nonexportableDetails;
+    bool m_asynchronousAvatarWrites;
 };
 
 SeasidePropertyHandler::SeasidePropertyHandler(const QSet<QContactDetail::DetailType> &nonexportableDetails)
@@ -268,7 +383,7 @@ void SeasidePropertyHandler::propertyProcessed(const QVersitDocument &, const QV
     const QString propertyName(property.name().toLower());
 
     if (propertyName == QLatin1String("photo")) {
-        processPhoto(property, alreadyProcessed, updatedDetails);
+        processPhoto(property, priv->m_asynchronousAvatarWrites, alreadyProcessed, updatedDetails);
     } else if (propertyName == QLatin1String("x-nemomobile-onlineaccount-demo")) {
         processOnlineAccount(property, alreadyProcessed, updatedDetails);
     } else if (propertyName == QLatin1String("x-nemomobile-synctarget")) {
@@ -292,7 +407,45 @@ void SeasidePropertyHandler::detailProcessed(const QContact &, const QContactDet
     }
 }
 
+/*
+ * Sets whether the avatar images of imported PHOTO properties are saved in
+ * the background.  If so, the contacts may refer to images which have not
+ * been saved yet, or which cannot be; the importer must then call
+ * waitForAvatarsSaved() before saving the contacts.
+ *
+ * The default is to save each image before its avatar is returned.
+ */
+void SeasidePropertyHandler::setAsynchronousAvatarWrites(bool asynchronous)
+{
+    priv->m_asynchronousAvatarWrites = asynchronous;
+}
+
+bool SeasidePropertyHandler::asynchronousAvatarWrites() const
+{
+    return priv->m_asynchronousAvatarWrites;
+}
+
 QContactAvatar SeasidePropertyHandler::avatarFromPhotoProperty(const QVersitProperty &property)
 {
-    return ::avatarFromPhotoProperty(property);
+    return ::avatarFromPhotoProperty(property, false);
+}
+
+/*
+ * Blocks until the avatar images at \a paths, as referred to by the avatars
+ * imported with asynchronous avatar writes, have been saved.  Images being
+ * saved for other callers are not waited for.
+ *
+ * Returns the paths at which no image could be saved, because the PHOTO
+ * data could not be decoded or the file could not be written.
+ */
+QStringList SeasidePropertyHandler::waitForAvatarsSaved(const QStringList &paths)
+{
+    avatarWriter()->waitFor(paths);
+
+    QStringList failedPaths;
+    foreach (const QString &path, paths) {
+        if (!QFile::exists(path))
+            failedPaths.append(path);
+    }
+    return failedPaths;
 }
@@ -36,6 +36,7 @@
 #include "contactcacheexport.h"
 
 #include <QString>
+#include <QStringList>
 #include <QByteArray>
 #include <QVariantMap>
 
@@ -82,8 +83,14 @@ public:
     void detailProcessed(const QContact &, const QContactDetail &detail,
                          const QVersitDocument &, QSet<int> * processedFields, QList<QVersitProperty> * toBeRemoved, QList<QVersitProperty> * toBeAdded);
 
+    void setAsynchronousAvatarWrites(bool asynchronous);
+    bool asynchronousAvatarWrites() const;
+
     static QContactAvatar avatarFromPhotoProperty(const QVersitProperty &property);
 
+    // Blocks until the avatar images at paths, saved in the background, have been saved
+    static QStringList waitForAvatarsSaved(const QStringList &paths);
+
 private:
     SeasidePropertyHandlerPrivate *priv;
 };
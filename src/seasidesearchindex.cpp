@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidesearchindex.h"
+
+#include <QHash>
+#include <QMap>
+#include <QVector>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// Decompose the text so that accented characters match their unaccented forms
+QString foldText(const QString &text)
+{
+    const QString decomposed(text.normalized(QString::NormalizationForm_KD));
+
+    QString folded;
+    folded.reserve(decomposed.size());
+    for (const QChar &c : decomposed) {
+        if (c.category() != QChar::Mark_NonSpacing)
+            folded.append(c);
+    }
+    return folded.toCaseFolded();
+}
+
+bool tokenCharacter(const QChar &c)
+{
+    return c.isLetterOrNumber() || c.isSurrogate();
+}
+
+}
+
+class SeasideSearchIndexPrivate
+{
+public:
+    void link(quint32 iid, const QStringList &tokens);
+    void unlink(quint32 iid, const QStringList &tokens);
+    QVector<quint32> matches(const QString &prefix) const;
+
+    // Each token maps to the ascending list of contacts containing that token
+    QMap<QString, QVector<quint32> > tokens;
+    QHash<quint32, QStringList> contactTokens;
+};
+
+void SeasideSearchIndexPrivate::link(quint32 iid, const QStringList &contactTokens)
+{
+    for (const QString &token : contactTokens) {
+        QVector<quint32> &iids(tokens[token]);
+        QVector<quint32>::iterator it = std::lower_bound(iids.begin(), iids.end(), iid);
+        if (it == iids.end() || *it != iid)
+            iids.insert(it, iid);
+    }
+}
+
+void SeasideSearchIndexPrivate::unlink(quint32 iid, const QStringList &contactTokens)
+{
+    for (const QString &token : contactTokens) {
+        QMap<QString, QVector<quint32> >::iterator tit = tokens.find(token);
+        if (tit == tokens.end())
+            continue;
+
+        QVector<quint32> &iids(*tit);
+        QVector<quint32>::iterator it = std::lower_bound(iids.begin(), iids.end(), iid);
+        if (it != iids.end() && *it == iid)
+            iids.erase(it);
+        if (iids.isEmpty())
+            tokens.erase(tit);
+    }
+}
+
+QVector<quint32> SeasideSearchIndexPrivate::matches(const QString &prefix) const
+{
+    QVector<quint32> rv;
+
+    QMap<QString, QVector<quint32> >::const_iterator it = tokens.lowerBound(prefix), end = tokens.constEnd();
+    for ( ; it != end && it.key().startsWith(prefix); ++it) {
+        rv += *it;
+    }
+
+    std::sort(rv.begin(), rv.end());
+    rv.erase(std::unique(rv.begin(), rv.end()), rv.end());
+    return rv;
+}
+
+SeasideSearchIndex::SeasideSearchIndex()
+    : d(new SeasideSearchIndexPrivate)
+{
+}
+
+SeasideSearchIndex::~SeasideSearchIndex()
+{
+    delete d;
+}
+
+int SeasideSearchIndex::count() const
+{
+    return d->contactTokens.count();
+}
+
+bool SeasideSearchIndex::contains(quint32 iid) const
+{
+    return d->contactTokens.contains(iid);
+}
+
+void SeasideSearchIndex::insert(quint32 iid, const QStringList &text)
+{
+    QStringList tokens;
+    for (const QString &item : text) {
+        tokens.append(tokenize(item));
+    }
+    tokens.sort();
+    tokens.removeDuplicates();
+
+    QHash<quint32, QStringList>::iterator it = d->contactTokens.find(iid);
+    if (it != d->contactTokens.end()) {
+        if (*it == tokens)
+            return;
+
+        d->unlink(iid, *it);
+    }
+
+    if (tokens.isEmpty()) {
+        if (it != d->contactTokens.end())
+            d->contactTokens.erase(it);
+        return;
+    }
+
+    d->link(iid, tokens);
+    d->contactTokens.insert(iid, tokens);
+}
+
+void SeasideSearchIndex::remove(quint32 iid)
+{
+    QHash<quint32, QStringList>::iterator it = d->contactTokens.find(iid);
+    if (it != d->contactTokens.end()) {
+        d->unlink(iid, *it);
+        d->contactTokens.erase(it);
+    }
+}
+
+void SeasideSearchIndex::clear()
+{
+    d->tokens.clear();
+    d->contactTokens.clear();
+}
+
+QList<quint32> SeasideSearchIndex::search(const QString &query) const
+{
+    QStringList queryTokens(tokenize(query));
+    if (queryTokens.isEmpty())
+        return QList<quint32>();
+
+    // The longest tokens are likely to be the most selective
+    queryTokens.removeDuplicates();
+    std::sort(queryTokens.begin(), queryTokens.end(), [](const QString &lhs, const QString &rhs) {
+        return lhs.length() > rhs.length();
+    });
+
+    QVector<quint32> rv(d->matches(queryTokens.first()));
+    for (int i = 1; i < queryTokens.count() && !rv.isEmpty(); ++i) {
+        const QVector<quint32> tokenMatches(d->matches(queryTokens.at(i)));
+
+        QVector<quint32> intersection;
+        intersection.reserve(qMin(rv.count(), tokenMatches.count()));
+        std::set_intersection(rv.constBegin(), rv.constEnd(),
+                              tokenMatches.constBegin(), tokenMatches.constEnd(),
+                              std::back_inserter(intersection));
+        rv = intersection;
+    }
+
+    return rv.toList();
+}
+
+QStringList SeasideSearchIndex::tokenize(const QString &text)
+{
+    QStringList rv;
+
+    const QString folded(foldText(text));
+    QString::const_iterator it = folded.constBegin(), end = folded.constEnd();
+    while (it != end) {
+        while (it != end && !tokenCharacter(*it))
+            ++it;
+
+        QString::const_iterator begin = it;
+        while (it != end && tokenCharacter(*it))
+            ++it;
+
+        if (it != begin)
+            rv.append(QString(begin, it - begin));
+    }
+
+    return rv;
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#ifndef SEASIDESEARCHINDEX_H
+#define SEASIDESEARCHINDEX_H
+
+#include "contactcacheexport.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class SeasideSearchIndexPrivate;
+
+// Index of the searchable text of cached contacts, held as an ordered map of case-folded
+// tokens stripped of diacritics.  Each token of a query matches any indexed token that it
+// is a prefix of, and a contact matches the query if all of the query tokens match one of
+// the tokens indexed for that contact.
+
+class CONTACTCACHE_EXPORT SeasideSearchIndex
+{
+public:
+    SeasideSearchIndex();
+    ~SeasideSearchIndex();
+
+    int count() const;
+    bool contains(quint32 iid) const;
+
+    // Replaces any text previously indexed for the contact
+    void insert(quint32 iid, const QStringList &text);
+    void remove(quint32 iid);
+    void clear();
+
+    // Returns the contacts matching the query, in ascending order
+    QList<quint32> search(const QString &query) const;
+
+    static QStringList tokenize(const QString &text);
+
+private:
+    Q_DISABLE_COPY(SeasideSearchIndex)
+
+    SeasideSearchIndexPrivate *d;
+};
+
+#endif
@@ -44,27 +44,47 @@ SOURCES += \
     $$PWD/cacheconfiguration.cpp \
     $$PWD/seasidecache.cpp \
     $$PWD/seasideexport.cpp \
+    $$PWD/seasideexportjob.cpp \
     $$PWD/seasideimport.cpp \
+    $$PWD/seasideimportjob.cpp \
+    $$PWD/seasidelocalcontactindex.cpp \
     $$PWD/seasidecontactbuilder.cpp \
+    $$PWD/seasidedialpadindex.cpp \
+    $$PWD/seasidephonenumberindex.cpp \
+    $$PWD/seasidesearchindex.cpp \
     $$PWD/seasidepropertyhandler.cpp
 
 HEADERS += \
     $$PWD/cacheconfiguration.h \
+    $$PWD/cacheitemstore.h \
     $$PWD/contactcacheexport.h \
     $$PWD/seasidecache.h \
     $$PWD/seasideexport.h \
+    $$PWD/seasideexportjob.h \
     $$PWD/seasideimport.h \
+    $$PWD/seasideimportjob.h \
+    $$PWD/seasidelocalcontactindex.h \
     $$PWD/seasidecontactbuilder.h \
+    $$PWD/seasidedialpadindex.h \
+    $$PWD/seasidephonenumberindex.h \
+    $$PWD/seasidesearchindex.h \
     $$PWD/synchronizelists.h \
     $$PWD/seasidepropertyhandler.h
 
 headers.files = \
     $$PWD/cacheconfiguration.h \
+    $$PWD/cacheitemstore.h \
     $$PWD/contactcacheexport.h \
     $$PWD/seasidecache.h \
     $$PWD/seasideexport.h \
+    $$PWD/seasideexportjob.h \
     $$PWD/seasideimport.h \
+    $$PWD/seasideimportjob.h \
+    $$PWD/seasidelocalcontactindex.h \
     $$PWD/seasidecontactbuilder.h \
+    $$PWD/seasidedialpadindex.h \
+    $$PWD/seasidephonenumberindex.h \
+    $$PWD/seasidesearchindex.h \
     $$PWD/synchronizelists.h \
     $$PWD/seasidepropertyhandler.h
 headers.path = $$PREFIX/include/$$TARGET
@@ -32,6 +32,11 @@
 #ifndef SYNCHRONIZELISTS_H
 #define SYNCHRONIZELISTS_H
 
+#include <QHash>
+#include <QVector>
+
+#include <algorithm>
+
 // Helper utility to synchronize a cached list with some reference list with correct
 // QAbstractItemModel signals and filtering.
 
@@ -39,7 +44,21 @@
 // same variables c and r to progressively synchronize the lists.  After the final call completeSynchronizeList
 // can be called to remove or append any items which remain unsynchronized.
 // The Filtered variants allow the reference list to be filtered by a callback function to
-// exclude unwanted items from the synchronized list.
+// exclude unwanted items from the synchronized list.  To synchronize a filtered list progressively,
+// pass the same FilteredReferenceList to each call of synchronizeFilteredList and completeSynchronizeList.
+
+// The engine used to find the differences between the lists may be selected by template parameter.
+// SynchronizeList scans both lists in parallel for the next common item, which is cheap when the
+// lists differ by a few scattered changes.  AnchoredSynchronizeList anchors the lists on the longest
+// sequence of items which occur in the same order in both, which remains O((N + M) log N) however
+// far items have moved; it requires that items are hashable, identified by equality, and occur
+// at most once in each list.
+
+// If the Agent provides moveRange(index, count, destination), AnchoredSynchronizeList reports items
+// which occur in both lists but out of order as moves rather than as removals and insertions, with
+// a single move for each run of adjacent items moved to the same place; finding the moves remains
+// O((N + M) log N).  As for QAbstractItemModel::beginMoveRows(), the destination is the index
+// before which the items are placed, in the list as it was before the move.
 
 template <typename T>
 bool compareIdentity(const T &item, const T &reference)
@@ -61,6 +80,22 @@ int removeRange(Agent *agent, int index, int count)
     return 0;
 }
 
+template <typename Agent>
+void moveRange(Agent *agent, int index, int count, int destination)
+{
+    agent->moveRange(index, count, destination);
+}
+
+template <typename Agent>
+class HasMoveRange
+{
+    template <typename T> static char test(decltype(static_cast<T *>(0)->moveRange(0, 0, 0)) *);
+    template <typename T> static long test(...);
+
+public:
+    enum { value = sizeof(test<Agent>(0)) == sizeof(char) };
+};
+
 template <typename Agent, typename ReferenceList>
 int updateRange(Agent *agent, int index, int count, const ReferenceList &source, int sourceIndex)
 {
@@ -71,6 +106,71 @@ int updateRange(Agent *agent, int index, int count, const ReferenceList &source,
     return count;
 }
 
+// A view of the values of a reference list accepted by the filterValue() function of the agent.
+// Values are filtered as they are first accessed and the result is remembered, so the reference
+// list is neither copied nor filtered again when it is synchronized progressively; the view
+// should then be kept for the duration of the synchronization, and the reference list may
+// be appended to between calls.  Only the positions of accepted values are stored, and not
+// even those until some value has been rejected.
+template <typename Agent, typename ReferenceList>
+class FilteredReferenceList
+{
+public:
+    typedef typename ReferenceList::value_type value_type;
+    typedef typename ReferenceList::const_reference const_reference;
+
+    FilteredReferenceList(Agent *agent, const ReferenceList &reference)
+        : m_agent(agent), m_reference(reference), m_evaluated(0), m_acceptedPrefix(0)
+    {
+    }
+
+    int count() const
+    {
+        evaluate(m_reference.count());
+        return m_acceptedPrefix + m_positions.count();
+    }
+
+    const_reference at(int index) const
+    {
+        while (index >= m_acceptedPrefix + m_positions.count() && m_evaluated < m_reference.count())
+            evaluate(m_evaluated + 1);
+
+        return m_reference.at(index < m_acceptedPrefix ? index : m_positions.at(index - m_acceptedPrefix));
+    }
+
+private:
+    void evaluate(int end) const
+    {
+        for (; m_evaluated < end; ++m_evaluated) {
+            if (!m_agent->filterValue(m_reference.at(m_evaluated))) {
+                continue;
+            } else if (m_evaluated == m_acceptedPrefix) {
+                ++m_acceptedPrefix;
+            } else {
+                m_positions.append(m_evaluated);
+            }
+        }
+    }
+
+    Agent * const m_agent;
+    const ReferenceList &m_reference;
+    mutable QVector<int> m_positions;
+    mutable int m_evaluated;
+    mutable int m_acceptedPrefix;
+};
+
+// Agents receive the inserted values in a list of the type filtered, rather than the view
+template <typename Agent, typename FilterAgent, typename ReferenceList>
+int insertRange(Agent *agent, int index, int count, const FilteredReferenceList<FilterAgent, ReferenceList> &source, int sourceIndex)
+{
+    ReferenceList values;
+    values.reserve(count);
+    for (int i = 0; i < count; ++i)
+        values.append(source.at(sourceIndex + i));
+
+    return insertRange(agent, index, count, values, 0);
+}
+
 template <typename Agent, typename CacheList, typename ReferenceList>
 class SynchronizeList
 {
@@ -192,6 +292,310 @@ private:
     int &r;
 };
 
+template <typename Agent, typename CacheList, typename ReferenceList>
+class AnchoredSynchronizeList
+{
+    typedef typename CacheList::value_type CacheValue;
+
+    template <bool> struct MoveSupport {};
+
+public:
+    AnchoredSynchronizeList(
+            Agent *agent,
+            const CacheList &cache,
+            int &c,
+            const ReferenceList &reference,
+            int &r)
+        : agent(agent), cache(cache), c(c), reference(reference), r(r)
+    {
+        QHash<CacheValue, int> cachePositions;
+        cachePositions.reserve(cache.count() - c);
+        for (int i = c; i < cache.count(); ++i)
+            cachePositions.insert(cache.at(i), i);
+
+        // The position in each list of the reference items which are also in the cache
+        for (int i = r; i < reference.count(); ++i) {
+            typename QHash<CacheValue, int>::const_iterator it = cachePositions.constFind(reference.at(i));
+            if (it != cachePositions.constEnd()) {
+                referencePositions.append(i);
+                cachedPositions.append(*it);
+            }
+        }
+
+        // Find the longest subsequence of those items whose cache positions are increasing
+        QVector<int> tails;
+        QVector<int> predecessors(cachedPositions.count());
+        for (int i = 0; i < cachedPositions.count(); ++i) {
+            int lower = 0;
+            int upper = tails.count();
+            while (lower < upper) {
+                const int mid = (lower + upper) / 2;
+                if (cachedPositions.at(tails.at(mid)) < cachedPositions.at(i)) {
+                    lower = mid + 1;
+                } else {
+                    upper = mid;
+                }
+            }
+
+            predecessors[i] = lower > 0 ? tails.at(lower - 1) : -1;
+            if (lower == tails.count()) {
+                tails.append(i);
+            } else {
+                tails[lower] = i;
+            }
+        }
+
+        anchors.resize(tails.count());
+        for (int i = tails.isEmpty() ? -1 : tails.last(), n = tails.count(); i != -1; i = predecessors.at(i))
+            anchors[--n] = i;
+
+        // Anything following the last anchor is left for a subsequent call or completeSynchronizeList
+        synchronize(MoveSupport<HasMoveRange<Agent>::value>());
+    }
+
+private:
+    // Resolves the differences preceding each run of anchors by removal and insertion
+    void synchronize(MoveSupport<false>)
+    {
+        int cacheOrigin = c;
+        for (int i = 0; i < anchors.count(); ) {
+            const int anchorC = cachedPositions.at(anchors.at(i));
+            const int anchorR = referencePositions.at(anchors.at(i));
+
+            int count = 1;
+            while (i + count < anchors.count()
+                    && cachedPositions.at(anchors.at(i + count)) == anchorC + count
+                    && referencePositions.at(anchors.at(i + count)) == anchorR + count) {
+                ++count;
+            }
+
+            if (anchorC > cacheOrigin)
+                c += removeRange(agent, c, anchorC - cacheOrigin);
+            if (anchorR > r)
+                c += insertRange(agent, c, anchorR - r, reference, r);
+            c += updateRange(agent, c, count, reference, anchorR);
+
+            r = anchorR + count;
+            cacheOrigin = anchorC + count;
+            i += count;
+        }
+    }
+
+    // Resolves the differences preceding each anchor, moving any items which are out of order.
+    // Each item which is not an anchor is moved once: back to the gap before the first anchor
+    // which follows it in the reference list, if it is reached in the cache before its turn, or
+    // else forward to its reference position.  The cache positions of items are counted in a
+    // Fenwick tree over the slots which they may occupy, so no move requires a search.
+    void synchronize(MoveSupport<true>)
+    {
+        if (anchors.isEmpty())
+            return;
+
+        // The reference position of each cached item which is also in the reference list
+        referenceIndices.reserve(referencePositions.count());
+        for (int i = 0; i < referencePositions.count(); ++i)
+            referenceIndices.insert(reference.at(referencePositions.at(i)), referencePositions.at(i));
+
+        anchorPositions.reserve(anchors.count());
+        for (int i = 0; i < anchors.count(); ++i)
+            anchorPositions.append(referencePositions.at(anchors.at(i)));
+
+        // Each cached item has a slot at its position, and each item which may be moved back
+        // has another in the gap it would be moved to; the slots are ordered as the items are
+        slotKeys.reserve(cache.count() - c + referencePositions.count());
+        for (int i = c; i < cache.count(); ++i)
+            slotKeys.append(originalKey(i));
+        for (int i = 0; i < referencePositions.count(); ++i) {
+            if (!isAnchor(referencePositions.at(i)))
+                slotKeys.append(movedKey(referencePositions.at(i)));
+        }
+        std::sort(slotKeys.begin(), slotKeys.end());
+
+        occupied.fill(0, slotKeys.count() + 1);
+        currentSlots.reserve(cache.count() - c);
+        for (int i = c; i < cache.count(); ++i) {
+            const int slot = slotIndex(originalKey(i));
+            occupy(slot);
+            currentSlots.insert(cache.at(i), slot);
+        }
+
+        const int lastAnchorR = anchorPositions.last();
+        while (r <= lastAnchorR) {
+            if (c < cache.count() && compareIdentity(cache.at(c), reference.at(r))) {
+                int count = 1;
+                while (c + count < cache.count() && r + count <= lastAnchorR
+                        && compareIdentity(cache.at(c + count), reference.at(r + count))) {
+                    ++count;
+                }
+                for (int i = 0; i < count; ++i)
+                    vacate(cache.at(c + i));
+                c += updateRange(agent, c, count, reference, r);
+                r += count;
+                continue;
+            }
+
+            if (c < cache.count() && !referenceIndices.contains(cache.at(c))) {
+                int count = 1;
+                while (c + count < cache.count() && !referenceIndices.contains(cache.at(c + count)))
+                    ++count;
+                for (int i = 0; i < count; ++i)
+                    vacate(cache.at(c + i));
+                c += removeRange(agent, c, count);
+                continue;
+            }
+
+            if (!referenceIndices.contains(reference.at(r))) {
+                int count = 1;
+                while (r + count <= lastAnchorR && !referenceIndices.contains(reference.at(r + count)))
+                    ++count;
+                c += insertRange(agent, c, count, reference, r);
+                r += count;
+                continue;
+            }
+
+            if (c < cache.count() && moveBack(lastAnchorR))
+                continue;
+
+            // The item is preceded by items which cannot move; bring it forward, with any
+            // following items which also belong here
+            const int index = position(reference.at(r));
+            int count = 1;
+            while (r + count <= lastAnchorR && !isAnchor(r + count)) {
+                const typename QHash<CacheValue, int>::const_iterator it = currentSlots.constFind(reference.at(r + count));
+                if (it == currentSlots.constEnd() || c + prefix(*it) != index + count)
+                    break;
+                ++count;
+            }
+
+            moveRange(agent, index, count, c);
+            for (int i = 0; i < count; ++i)
+                vacate(reference.at(r + i));
+            c += count;
+            r += count;
+        }
+
+        // Items moved beyond the last anchor may now be ordered correctly
+        if (r < reference.count() && c < cache.count())
+            AnchoredSynchronizeList(agent, cache, c, reference, r);
+    }
+
+    // Moves the item at c back to the gap before the next anchor following its reference position,
+    // with any following items which belong after it in the same gap.  Returns false if the item
+    // has been moved already, or is in its gap already.
+    bool moveBack(int lastAnchorR)
+    {
+        const CacheValue value(cache.at(c));
+        const int referencePosition = referenceIndices.value(value);
+        if (isAnchor(referencePosition) || !isOriginalSlot(currentSlots.value(value)))
+            return false;
+
+        const qint64 key = movedKey(referencePosition);
+        const int slot = slotIndex(key);
+
+        int count = 1;
+        while (c + count < cache.count() && referencePosition + count <= lastAnchorR) {
+            const CacheValue &next = cache.at(c + count);
+            const typename QHash<CacheValue, int>::const_iterator it = referenceIndices.constFind(next);
+            if (it == referenceIndices.constEnd() || *it != referencePosition + count || isAnchor(*it)
+                    || movedKey(*it) != key + count || !isOriginalSlot(currentSlots.value(next))) {
+                break;
+            }
+            ++count;
+        }
+
+        const int destination = c + prefix(slot);
+        if (destination <= c + count)
+            return false;
+
+        QVector<CacheValue> values;
+        values.reserve(count);
+        for (int i = 0; i < count; ++i)
+            values.append(cache.at(c + i));
+
+        moveRange(agent, c, count, destination);
+
+        for (int i = 0; i < count; ++i) {
+            vacate(values.at(i));
+            occupy(slot + i);
+            currentSlots.insert(values.at(i), slot + i);
+        }
+        return true;
+    }
+
+    bool isAnchor(int referencePosition) const
+    {
+        return std::binary_search(anchorPositions.constBegin(), anchorPositions.constEnd(), referencePosition);
+    }
+
+    // Slots are keyed by the cache position they precede or occupy, then by reference position
+    static qint64 originalKey(int cachePosition)
+    {
+        return static_cast<qint64>(2 * cachePosition + 1) << 32;
+    }
+
+    qint64 movedKey(int referencePosition) const
+    {
+        const int next = std::upper_bound(anchorPositions.constBegin(), anchorPositions.constEnd(), referencePosition) - anchorPositions.constBegin();
+        const int cachePosition = (next < anchors.count())
+                ? cachedPositions.at(anchors.at(next))
+                : cachedPositions.at(anchors.last()) + 1;
+        return (static_cast<qint64>(2 * cachePosition) << 32) | referencePosition;
+    }
+
+    bool isOriginalSlot(int slot) const
+    {
+        return (slotKeys.at(slot) >> 32) & 1;
+    }
+
+    int slotIndex(qint64 key) const
+    {
+        return std::lower_bound(slotKeys.constBegin(), slotKeys.constEnd(), key) - slotKeys.constBegin();
+    }
+
+    void occupy(int slot)
+    {
+        for (int i = slot + 1; i < occupied.count(); i += i & -i)
+            ++occupied[i];
+    }
+
+    void vacate(const CacheValue &value)
+    {
+        for (int i = currentSlots.take(value) + 1; i < occupied.count(); i += i & -i)
+            --occupied[i];
+    }
+
+    // The number of occupied slots preceding slot
+    int prefix(int slot) const
+    {
+        int count = 0;
+        for (int i = slot; i > 0; i -= i & -i)
+            count += occupied.at(i);
+        return count;
+    }
+
+    int position(const CacheValue &value) const
+    {
+        return c + prefix(currentSlots.value(value));
+    }
+
+    Agent * const agent;
+    const CacheList &cache;
+    int &c;
+    const ReferenceList &reference;
+    int &r;
+
+    QVector<int> referencePositions;
+    QVector<int> cachedPositions;
+    QVector<int> anchors;
+
+    // Used only to report moves
+    QHash<CacheValue, int> referenceIndices;
+    QVector<int> anchorPositions;
+    QVector<qint64> slotKeys;
+    QVector<int> occupied;
+    QHash<CacheValue, int> currentSlots;
+};
+
 template <typename Agent, typename CacheList, typename ReferenceList>
 void completeSynchronizeList(
         Agent *agent,
@@ -201,17 +605,18 @@ void completeSynchronizeList(
         int &referenceIndex)
 {
     if (cacheIndex < cache.count()) {
-        agent->removeRange(cacheIndex, cache.count() - cacheIndex);
+        removeRange(agent, cacheIndex, cache.count() - cacheIndex);
     }
     if (referenceIndex < reference.count()) {
-        agent->insertRange(cache.count(), reference.count() - referenceIndex, reference, referenceIndex);
+        insertRange(agent, cache.count(), reference.count() - referenceIndex, reference, referenceIndex);
     }
 
     cacheIndex = 0;
     referenceIndex = 0;
 }
 
-template <typename Agent, typename CacheList, typename ReferenceList>
+template <template <typename, typename, typename> class Engine = SynchronizeList,
+          typename Agent, typename CacheList, typename ReferenceList>
 void synchronizeList(
         Agent *agent,
         const CacheList &cache,
@@ -219,16 +624,17 @@ void synchronizeList(
         const ReferenceList &reference,
         int &referenceIndex)
 {
-    SynchronizeList<Agent, CacheList, ReferenceList>(
+    Engine<Agent, CacheList, ReferenceList>(
                 agent, cache, cacheIndex, reference, referenceIndex);
 }
 
-template <typename Agent, typename CacheList, typename ReferenceList>
+template <template <typename, typename, typename> class Engine = SynchronizeList,
+          typename Agent, typename CacheList, typename ReferenceList>
 void synchronizeList(Agent *agent, const CacheList &cache, const ReferenceList &reference)
 {
     int cacheIndex = 0;
     int referenceIndex = 0;
-    synchronizeList(agent, cache, cacheIndex, reference, referenceIndex);
+    synchronizeList<Engine>(agent, cache, cacheIndex, reference, referenceIndex);
     completeSynchronizeList(agent, cache, cacheIndex, reference, referenceIndex);
 }
 
@@ -246,7 +652,22 @@ ReferenceList filterList(
     return filtered;
 }
 
-template <typename Agent, typename CacheList, typename ReferenceList>
+template <template <typename, typename, typename> class Engine = SynchronizeList,
+          typename Agent, typename CacheList, typename ReferenceList>
+void synchronizeFilteredList(
+        Agent *agent,
+        const CacheList &cache,
+        int &cacheIndex,
+        const FilteredReferenceList<Agent, ReferenceList> &filtered,
+        int &referenceIndex)
+{
+    // The view is kept by the caller, so values already filtered are not filtered again
+    synchronizeList<Engine>(agent, cache, cacheIndex, filtered, referenceIndex);
+}
+
+// Filters the reference list again on each call; prefer to keep a FilteredReferenceList
+template <template <typename, typename, typename> class Engine = SynchronizeList,
+          typename Agent, typename CacheList, typename ReferenceList>
 void synchronizeFilteredList(
         Agent *agent,
         const CacheList &cache,
@@ -254,17 +675,18 @@ void synchronizeFilteredList(
         const ReferenceList &reference,
         int &referenceIndex)
 {
-    ReferenceList filtered = filterList(agent, reference);
-    synchronizeList(agent, cache, cacheIndex, filtered, referenceIndex);
+    const FilteredReferenceList<Agent, ReferenceList> filtered(agent, reference);
+    synchronizeFilteredList<Engine>(agent, cache, cacheIndex, filtered, referenceIndex);
 }
 
-template <typename Agent, typename CacheList, typename ReferenceList>
+template <template <typename, typename, typename> class Engine = SynchronizeList,
+          typename Agent, typename CacheList, typename ReferenceList>
 void synchronizeFilteredList(Agent *agent, const CacheList &cache, const ReferenceList &reference)
 {
     int cacheIndex = 0;
     int referenceIndex = 0;
-    ReferenceList filtered = filterList(agent, reference);
-    synchronizeList(agent, cache, cacheIndex, filtered, referenceIndex);
+    const FilteredReferenceList<Agent, ReferenceList> filtered(agent, reference);
+    synchronizeList<Engine>(agent, cache, cacheIndex, filtered, referenceIndex);
     completeSynchronizeList(agent, cache, cacheIndex, filtered, referenceIndex);
 }
 
@@ -1,7 +1,7 @@
 include(../package.pri)
 
 TEMPLATE = subdirs
-SUBDIRS = tst_synchronizelists tst_seasideimport tst_resolve
+SUBDIRS = tst_synchronizelists tst_cacheitemstore tst_phonenumberindex tst_searchindex tst_dialpadindex tst_seasideimport tst_importjob tst_exportjob tst_localcontactindex tst_resolve
 OTHER_FILES += tests.xml.in
 
 tests_xml.target = tests.xml
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include <QObject>
+#include <QtTest>
+
+#include "cacheitemstore.h"
+
+namespace {
+
+struct Item
+{
+    Item() : value(0) { ++instances; }
+    ~Item() { --instances; }
+
+    int value;
+    QString text;
+
+    static int instances;
+};
+
+int Item::instances = 0;
+
+}
+
+class tst_CacheItemStore : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void insertAndFind();
+    void pointerStability();
+    void remove();
+    void iterate();
+    void randomized();
+};
+
+void tst_CacheItemStore::insertAndFind()
+{
+    CacheItemStore<Item> store;
+    QVERIFY(store.isEmpty());
+    QVERIFY(!store.find(1));
+    QVERIFY(!store.contains(1));
+
+    store[1].value = 10;
+    store[2].value = 20;
+    QCOMPARE(store.count(), 2);
+    QVERIFY(store.contains(1));
+    QCOMPARE(store.find(1)->value, 10);
+    QCOMPARE(store.find(2)->value, 20);
+    QVERIFY(!store.find(3));
+
+    // An existing item is returned rather than replaced
+    QCOMPARE(store[1].value, 10);
+    QCOMPARE(store.count(), 2);
+}
+
+void tst_CacheItemStore::pointerStability()
+{
+    CacheItemStore<Item> store;
+
+    Item *first = &store[1];
+    first->text = QStringLiteral("first");
+
+    // Grow the store through several slabs and index resizes
+    for (quint32 key = 2; key < 5000; ++key)
+        store[key].value = key;
+
+    QCOMPARE(store.find(1), first);
+    QCOMPARE(first->text, QStringLiteral("first"));
+    QCOMPARE(store.find(4999)->value, 4999);
+}
+
+void tst_CacheItemStore::remove()
+{
+    {
+        CacheItemStore<Item> store;
+        for (quint32 key = 0; key < 1000; ++key)
+            store[key].value = key;
+        QCOMPARE(Item::instances, 1000);
+
+        for (quint32 key = 0; key < 1000; key += 2)
+            QVERIFY(store.remove(key));
+        QVERIFY(!store.remove(0));
+        QCOMPARE(store.count(), 500);
+        QCOMPARE(Item::instances, 500);
+
+        for (quint32 key = 0; key < 1000; ++key) {
+            if (key % 2) {
+                QVERIFY(store.find(key));
+                QCOMPARE(store.find(key)->value, static_cast<int>(key));
+            } else {
+                QVERIFY(!store.find(key));
+            }
+        }
+
+        // Freed slots are reused
+        store[2000].value = 2000;
+        QCOMPARE(store.find(2000)->value, 2000);
+    }
+    QCOMPARE(Item::instances, 0);
+}
+
+void tst_CacheItemStore::iterate()
+{
+    CacheItemStore<Item> store;
+    QSet<quint32> keys;
+    for (quint32 key = 100; key < 700; ++key) {
+        store[key].value = key * 2;
+        keys.insert(key);
+    }
+    for (quint32 key = 100; key < 700; key += 3) {
+        store.remove(key);
+        keys.remove(key);
+    }
+
+    QSet<quint32> visited;
+    for (CacheItemStore<Item>::iterator it = store.begin(); it != store.end(); ++it) {
+        QCOMPARE(it->value, static_cast<int>(it.key() * 2));
+        visited.insert(it.key());
+    }
+    QCOMPARE(visited, keys);
+
+    const CacheItemStore<Item> &constStore(store);
+    int count = 0;
+    for (CacheItemStore<Item>::const_iterator it = constStore.constBegin(); it != constStore.constEnd(); ++it)
+        ++count;
+    QCOMPARE(count, keys.count());
+}
+
+void tst_CacheItemStore::randomized()
+{
+    CacheItemStore<Item> store;
+    QHash<quint32, int> reference;
+    QHash<quint32, Item *> pointers;
+
+    qsrand(1);
+    for (int i = 0; i < 50000; ++i) {
+        const quint32 key = qrand() % 3000;
+        if (qrand() % 3) {
+            Item &item(store[key]);
+            if (pointers.contains(key))
+                QCOMPARE(&item, pointers.value(key));
+            item.value = i;
+            reference.insert(key, i);
+            pointers.insert(key, &item);
+        } else {
+            QCOMPARE(store.remove(key), reference.remove(key) == 1);
+            pointers.remove(key);
+        }
+    }
+
+    QCOMPARE(store.count(), reference.count());
+    for (QHash<quint32, int>::const_iterator it = reference.constBegin(); it != reference.constEnd(); ++it) {
+        const Item *item = store.find(it.key());
+        QVERIFY(item);
+        QCOMPARE(item->value, it.value());
+        QCOMPARE(item, pointers.value(it.key()));
+    }
+}
+
+#include "tst_cacheitemstore.moc"
+QTEST_APPLESS_MAIN(tst_CacheItemStore)
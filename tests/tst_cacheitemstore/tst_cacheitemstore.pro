@@ -0,0 +1,4 @@
+include(../common.pri)
+TARGET = tst_cacheitemstore
+
+SOURCES += tst_cacheitemstore.cpp
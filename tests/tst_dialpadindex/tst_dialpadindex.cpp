@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidedialpadindex.h"
+
+#include <QObject>
+#include <QtTest>
+
+class tst_DialpadIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void keypadDigits();
+    void nameMatch();
+    void numberMatch();
+    void ranking();
+    void update();
+    void setName();
+    void remove();
+    void search_data();
+    void search();
+};
+
+void tst_DialpadIndex::keypadDigits()
+{
+    QCOMPARE(SeasideDialpadIndex::keypadDigits(QStringLiteral("matti")), QStringLiteral("62884"));
+    QCOMPARE(SeasideDialpadIndex::keypadDigits(QStringLiteral("wxyz09")), QStringLiteral("999909"));
+    QCOMPARE(SeasideDialpadIndex::keypadDigits(QString::fromUtf8("ж")), QString());
+}
+
+void tst_DialpadIndex::nameMatch()
+{
+    SeasideDialpadIndex index;
+    index.insert(1, QStringLiteral("Matti Korhonen"), QStringList());
+    index.insert(2, QString::fromUtf8("Jörg Mäkinen"), QStringList());
+
+    QCOMPARE(index.search(QStringLiteral("628")), QList<quint32>() << 1);
+    QCOMPARE(index.search(QStringLiteral("567")), QList<quint32>() << 2 << 1);
+    QCOMPARE(index.search(QStringLiteral("625")), QList<quint32>() << 2);
+    QCOMPARE(index.search(QStringLiteral("999")), QList<quint32>());
+}
+
+void tst_DialpadIndex::numberMatch()
+{
+    SeasideDialpadIndex index;
+    index.insert(1, QString(), QStringList() << QStringLiteral("040 123 4567") << QStringLiteral("+358401234567"));
+    index.insert(2, QString(), QStringList() << QStringLiteral("+1 (415) 555-0100"));
+
+    QCOMPARE(index.search(QStringLiteral("0401")), QList<quint32>() << 1);
+    QCOMPARE(index.search(QStringLiteral("3584")), QList<quint32>() << 1);
+    QCOMPARE(index.search(QStringLiteral("5550")), QList<quint32>() << 2);
+    QCOMPARE(index.search(QStringLiteral("4567")), QList<quint32>() << 1);
+    QCOMPARE(index.search(QStringLiteral("7777")), QList<quint32>());
+}
+
+void tst_DialpadIndex::ranking()
+{
+    SeasideDialpadIndex index;
+    index.insert(1, QStringLiteral("Pekka Laine"), QStringList() << QStringLiteral("0401234567"));
+    index.insert(2, QStringLiteral("Aino Laine"), QStringList() << QStringLiteral("0507654321"));
+    index.insert(3, QStringLiteral("Sanna Virtanen"), QStringList() << QStringLiteral("0505246300"));
+    index.insert(4, QStringLiteral("Laine Oy"), QStringList());
+
+    // 5246 spells "laine", and also appears within a number
+    QCOMPARE(index.search(QStringLiteral("5246")), QList<quint32>() << 4 << 1 << 2 << 3);
+    QCOMPARE(index.rank(4, QStringLiteral("5246")), SeasideDialpadIndex::FirstNamePrefix);
+    QCOMPARE(index.rank(1, QStringLiteral("5246")), SeasideDialpadIndex::NamePrefix);
+    QCOMPARE(index.rank(3, QStringLiteral("5246")), SeasideDialpadIndex::NumberSubstring);
+    QCOMPARE(index.rank(1, QStringLiteral("0401")), SeasideDialpadIndex::NumberPrefix);
+    QCOMPARE(index.rank(4, QStringLiteral("0401")), SeasideDialpadIndex::NoMatch);
+}
+
+void tst_DialpadIndex::update()
+{
+    SeasideDialpadIndex index;
+    index.insert(1, QStringLiteral("Matti Korhonen"), QStringList() << QStringLiteral("0401234567"));
+    index.insert(1, QStringLiteral("Matti Laine"), QStringList() << QStringLiteral("0507654321"));
+
+    QCOMPARE(index.count(), 1);
+    QCOMPARE(index.search(QStringLiteral("567")), QList<quint32>());
+    QCOMPARE(index.search(QStringLiteral("0401")), QList<quint32>());
+    QCOMPARE(index.search(QStringLiteral("5246")), QList<quint32>() << 1);
+    QCOMPARE(index.search(QStringLiteral("0507")), QList<quint32>() << 1);
+}
+
+void tst_DialpadIndex::setName()
+{
+    SeasideDialpadIndex index;
+    index.insert(1, QStringLiteral("Laine Pekka"), QStringList() << QStringLiteral("0401234567"));
+    QCOMPARE(index.rank(1, QStringLiteral("5246")), SeasideDialpadIndex::FirstNamePrefix);
+
+    // Reordering the name changes the ranking, and keeps the numbers
+    index.setName(1, QStringLiteral("Pekka Laine"));
+    QCOMPARE(index.rank(1, QStringLiteral("5246")), SeasideDialpadIndex::NamePrefix);
+    QCOMPARE(index.rank(1, QStringLiteral("7355")), SeasideDialpadIndex::FirstNamePrefix);
+    QCOMPARE(index.rank(1, QStringLiteral("0401")), SeasideDialpadIndex::NumberPrefix);
+
+    index.setName(1, QStringLiteral("Matti Laine"));
+    QCOMPARE(index.search(QStringLiteral("7355")), QList<quint32>());
+    QCOMPARE(index.search(QStringLiteral("6288")), QList<quint32>() << 1);
+    QCOMPARE(index.search(QStringLiteral("0401")), QList<quint32>() << 1);
+}
+
+void tst_DialpadIndex::remove()
+{
+    SeasideDialpadIndex index;
+    for (int i = 0; i < 2000; ++i) {
+        index.insert(i + 1, QStringLiteral("Matti"), QStringList() << QStringLiteral("+35840%1").arg(i, 7, 10, QLatin1Char('0')));
+    }
+
+    // Removing most of the numbers causes the buffer to be compacted
+    for (int i = 0; i < 1900; ++i) {
+        index.remove(i + 1);
+    }
+    QCOMPARE(index.count(), 100);
+    QVERIFY(!index.contains(1));
+    QCOMPARE(index.search(QStringLiteral("0001899")), QList<quint32>());
+    QCOMPARE(index.search(QStringLiteral("1950")), QList<quint32>() << 1951);
+    QCOMPARE(index.search(QStringLiteral("62884")).count(), 100);
+
+    index.clear();
+    QCOMPARE(index.count(), 0);
+    QCOMPARE(index.search(QStringLiteral("62884")), QList<quint32>());
+}
+
+void tst_DialpadIndex::search_data()
+{
+    QTest::addColumn<QString>("digits");
+
+    QTest::newRow("one digit") << QStringLiteral("5");
+    QTest::newRow("three digits") << QStringLiteral("524");
+    QTest::newRow("number") << QStringLiteral("0401234");
+}
+
+void tst_DialpadIndex::search()
+{
+    QFETCH(QString, digits);
+
+    static const char *const names[] = { "Aino Virtanen", "Matti Korhonen", "Pekka Laine", "Sanna Nieminen" };
+
+    SeasideDialpadIndex index;
+    for (int i = 0; i < 10000; ++i) {
+        index.insert(i + 1, QString::fromLatin1(names[i % 4]),
+                     QStringList() << QStringLiteral("040%1").arg(1230000 + i, 7, 10, QLatin1Char('0')));
+    }
+
+    QBENCHMARK {
+        QVERIFY(!index.search(digits).isEmpty());
+    }
+}
+
+#include "tst_dialpadindex.moc"
+QTEST_APPLESS_MAIN(tst_DialpadIndex)
@@ -0,0 +1,7 @@
+include(../../config.pri)
+include(../common.pri)
+TARGET = tst_dialpadindex
+
+SOURCES += tst_dialpadindex.cpp
+
+LIBS += ../../src/libcontactcache-qt5.so
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include "seasideexportjob.h"
+
+#include <QContactName>
+
+#include <QVersitContactImporter>
+#include <QVersitReader>
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+QTVERSIT_USE_NAMESPACE
+
+class tst_ExportJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_ExportJob();
+
+private slots:
+    void initTestCase();
+    void pages();
+    void filtered();
+    void empty();
+    void cancel();
+    void unwritable();
+
+private:
+    QContactManager m_manager;
+    QList<QContactId> m_contactIds;
+    QTemporaryDir m_dir;
+};
+
+
+tst_ExportJob::tst_ExportJob()
+    : m_manager(QStringLiteral("memory"))
+{
+}
+
+void tst_ExportJob::initTestCase()
+{
+    QList<QContact> contacts;
+    for (int i = 0; i < 250; ++i) {
+        QContactName name;
+        name.setFirstName(QStringLiteral("Test"));
+        name.setLastName(QStringLiteral("Contact%1").arg(i));
+
+        QContact contact;
+        contact.saveDetail(&name);
+        contacts.append(contact);
+    }
+
+    QVERIFY(m_manager.saveContacts(&contacts));
+    foreach (const QContact &contact, contacts)
+        m_contactIds.append(contact.id());
+}
+
+void tst_ExportJob::pages()
+{
+    const QString path(m_dir.path() + QStringLiteral("/pages.vcf"));
+
+    SeasideExportJob job(&m_manager, m_contactIds, path);
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+
+    job.start();
+    QCOMPARE(job.status(), SeasideExportJob::Active);
+    QCOMPARE(job.contactsTotal(), 250);
+
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideExportJob::Finished);
+    QCOMPARE(job.contactsWritten(), 250);
+
+    // The pages are appended to the file in the order of the ids
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    QVersitReader reader(&file);
+    QVERIFY(reader.startReading() && reader.waitForFinished());
+
+    QVersitContactImporter importer;
+    QVERIFY(importer.importDocuments(reader.results()));
+
+    const QList<QContact> contacts(importer.contacts());
+    QCOMPARE(contacts.count(), 250);
+    for (int i = 0; i < contacts.count(); ++i)
+        QCOMPARE(contacts.at(i).detail<QContactName>().lastName(), QStringLiteral("Contact%1").arg(i));
+}
+
+void tst_ExportJob::filtered()
+{
+    const QString path(m_dir.path() + QStringLiteral("/filtered.vcf"));
+
+    QContactSortOrder order;
+    order.setDetailType(QContactName::Type, QContactName::FieldLastName);
+    order.setDirection(Qt::DescendingOrder);
+
+    // The ids are queried by the job, after it is started
+    SeasideExportJob job(&m_manager, QContactFilter(), QList<QContactSortOrder>() << order, path);
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+    QCOMPARE(job.contactsTotal(), 0);
+
+    job.start();
+    QCOMPARE(job.status(), SeasideExportJob::Active);
+
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideExportJob::Finished);
+    QCOMPARE(job.contactsTotal(), 250);
+    QCOMPARE(job.contactsWritten(), 250);
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+
+    QVersitReader reader(&file);
+    QVERIFY(reader.startReading() && reader.waitForFinished());
+
+    QVersitContactImporter importer;
+    QVERIFY(importer.importDocuments(reader.results()));
+
+    // The contacts are written in the requested order
+    const QList<QContact> contacts(importer.contacts());
+    QCOMPARE(contacts.count(), 250);
+    QVERIFY(contacts.first().detail<QContactName>().lastName() > contacts.last().detail<QContactName>().lastName());
+}
+
+void tst_ExportJob::empty()
+{
+    const QString path(m_dir.path() + QStringLiteral("/empty.vcf"));
+
+    SeasideExportJob job(&m_manager, QList<QContactId>(), path);
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+
+    job.start();
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideExportJob::Finished);
+    QCOMPARE(job.contactsWritten(), 0);
+    QVERIFY(QFile::exists(path));
+}
+
+void tst_ExportJob::cancel()
+{
+    const QString path(m_dir.path() + QStringLiteral("/cancelled.vcf"));
+
+    SeasideExportJob job(&m_manager, m_contactIds, path);
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+
+    job.start();
+    job.cancel();
+    QCOMPARE(job.status(), SeasideExportJob::Cancelled);
+
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideExportJob::Cancelled);
+    QVERIFY(!QFile::exists(path));
+}
+
+void tst_ExportJob::unwritable()
+{
+    SeasideExportJob job(&m_manager, m_contactIds, m_dir.path() + QStringLiteral("/missing/unwritable.vcf"));
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+
+    job.start();
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideExportJob::Error);
+    QCOMPARE(job.contactsWritten(), 0);
+}
+
+#include "tst_exportjob.moc"
+QTEST_GUILESS_MAIN(tst_ExportJob)
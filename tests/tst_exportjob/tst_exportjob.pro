@@ -0,0 +1,7 @@
+include(../../config.pri)
+include(../common.pri)
+TARGET = tst_exportjob
+
+SOURCES += tst_exportjob.cpp
+
+LIBS += ../../src/libcontactcache-qt5.so
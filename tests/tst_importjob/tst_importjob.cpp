@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+#include "seasideimportjob.h"
+
+#include <QContactName>
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+class tst_ImportJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_ImportJob();
+
+    QString writeVCards(int count);
+
+private slots:
+    void chunks();
+    void pendingChunksBounded();
+    void missingFile();
+
+private:
+    QTemporaryDir m_dir;
+};
+
+
+tst_ImportJob::tst_ImportJob()
+{
+}
+
+QString tst_ImportJob::writeVCards(int count)
+{
+    const QString path(m_dir.path() + QStringLiteral("/contacts-%1.vcf").arg(count));
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return QString();
+
+    for (int i = 0; i < count; ++i) {
+        file.write("BEGIN:VCARD\r\nVERSION:3.0\r\n");
+        file.write(QStringLiteral("N:Contact%1;Test;;;\r\n").arg(i).toUtf8());
+        file.write(QStringLiteral("TEL:+35840%1\r\n").arg(i, 7, 10, QLatin1Char('0')).toUtf8());
+        file.write("END:VCARD\r\n");
+    }
+
+    return path;
+}
+
+void tst_ImportJob::chunks()
+{
+    const QString path(writeVCards(250));
+    QVERIFY(!path.isEmpty());
+
+    SeasideImportJob job(path);
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+
+    // Save each chunk as it becomes available, as SeasideCache does
+    QList<QContact> imported;
+    connect(&job, &SeasideImportJob::contactsAvailable, [&job, &imported] {
+        while (job.hasPendingContacts()) {
+            const QList<QContact> contacts(job.takeContacts());
+            QVERIFY(contacts.count() <= 100);
+            imported += contacts;
+            job.contactsSaveFinished(contacts.count(), 0);
+        }
+    });
+
+    job.start();
+    QCOMPARE(job.status(), SeasideImportJob::Active);
+
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideImportJob::Finished);
+    QCOMPARE(job.documentsRead(), 250);
+    QCOMPARE(job.contactsSaved(), 250);
+    QCOMPARE(job.bytesRead(), job.bytesTotal());
+
+    QCOMPARE(imported.count(), 250);
+    for (int i = 0; i < imported.count(); ++i)
+        QCOMPARE(imported.at(i).detail<QContactName>().lastName(), QStringLiteral("Contact%1").arg(i));
+}
+
+void tst_ImportJob::pendingChunksBounded()
+{
+    const QString path(writeVCards(2000));
+    QVERIFY(!path.isEmpty());
+
+    SeasideImportJob job(path);
+    QSignalSpy availableSpy(&job, SIGNAL(contactsAvailable()));
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+
+    job.start();
+    QTRY_VERIFY(availableSpy.count() >= 2);
+
+    // Nothing has been taken, so the reader should be waiting with at most two chunks converted
+    QTest::qWait(100);
+    QVERIFY(job.documentsRead() <= 200);
+    QVERIFY(job.bytesRead() < job.bytesTotal());
+
+    const QList<QContact> contacts(job.takeContacts());
+    QCOMPARE(contacts.count(), 100);
+    QTRY_VERIFY(job.documentsRead() > 200);
+
+    job.cancel();
+    QCOMPARE(job.status(), SeasideImportJob::Cancelled);
+    QVERIFY(!job.hasPendingContacts());
+
+    // The job is not finished while the taken chunk is being saved
+    QTest::qWait(50);
+    QCOMPARE(finishedSpy.count(), 0);
+
+    job.contactsSaveFinished(contacts.count(), 0);
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideImportJob::Cancelled);
+    QCOMPARE(job.contactsSaved(), 100);
+}
+
+void tst_ImportJob::missingFile()
+{
+    SeasideImportJob job(m_dir.path() + QStringLiteral("/missing.vcf"));
+    QSignalSpy finishedSpy(&job, SIGNAL(finished()));
+
+    job.start();
+    QTRY_COMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job.status(), SeasideImportJob::Error);
+    QCOMPARE(job.documentsRead(), 0);
+}
+
+#include "tst_importjob.moc"
+QTEST_GUILESS_MAIN(tst_ImportJob)
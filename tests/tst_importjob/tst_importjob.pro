@@ -0,0 +1,7 @@
+include(../../config.pri)
+include(../common.pri)
+TARGET = tst_importjob
+
+SOURCES += tst_importjob.cpp
+
+LIBS += ../../src/libcontactcache-qt5.so
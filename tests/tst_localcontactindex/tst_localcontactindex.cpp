@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidelocalcontactindex.h"
+
+#include <QContactGuid>
+#include <QContactName>
+#include <QContactNickname>
+#include <QContactSyncTarget>
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QtTest>
+
+class tst_LocalContactIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_LocalContactIndex();
+
+private slots:
+    void init();
+    void populate();
+    void incremental();
+    void sharedKeys();
+    void stored();
+
+private:
+    QContact saveContact(const QString &syncTarget, const QString &guid, const QString &lastName, const QString &nickname = QString());
+
+    QContactManager m_manager;
+    QTemporaryDir m_dir;
+};
+
+
+tst_LocalContactIndex::tst_LocalContactIndex()
+    : m_manager(QStringLiteral("memory"))
+{
+}
+
+void tst_LocalContactIndex::init()
+{
+    const QList<QContactId> ids(m_manager.contactIds());
+    if (!ids.isEmpty())
+        QVERIFY(m_manager.removeContacts(ids));
+}
+
+QContact tst_LocalContactIndex::saveContact(const QString &syncTarget, const QString &guid, const QString &lastName, const QString &nickname)
+{
+    QContact contact;
+
+    QContactSyncTarget target;
+    target.setSyncTarget(syncTarget);
+    contact.saveDetail(&target);
+
+    if (!guid.isEmpty()) {
+        QContactGuid guidDetail;
+        guidDetail.setGuid(guid);
+        contact.saveDetail(&guidDetail);
+    }
+    if (!lastName.isEmpty()) {
+        QContactName name;
+        name.setFirstName(QStringLiteral("Test"));
+        name.setLastName(lastName);
+        contact.saveDetail(&name);
+    }
+    if (!nickname.isEmpty()) {
+        QContactNickname nick;
+        nick.setNickname(nickname);
+        contact.saveDetail(&nick);
+    }
+
+    m_manager.saveContact(&contact);
+    return contact;
+}
+
+void tst_LocalContactIndex::populate()
+{
+    const QContact local(saveContact(QStringLiteral("local"), QStringLiteral("guid-1"), QStringLiteral("Local")));
+    const QContact wasLocal(saveContact(QStringLiteral("was_local"), QString(), QString(), QStringLiteral("Nick")));
+    saveContact(QStringLiteral("other"), QStringLiteral("guid-2"), QStringLiteral("Other"));
+
+    SeasideLocalContactIndex index(&m_manager, SeasideLocalContactIndex::localContactFilter());
+    index.refresh();
+
+    const QString localName(SeasideLocalContactIndex::contactNameString(local));
+    QCOMPARE(localName, QStringLiteral("|Test||Local|"));
+
+    QCOMPARE(index.guids().count(), 1);
+    QCOMPARE(index.guids().value(QStringLiteral("guid-1")), local.id());
+    QCOMPARE(index.names().count(), 1);
+    QCOMPARE(index.names().value(localName), local.id());
+    QCOMPARE(index.contactNames().count(), 1);
+    QCOMPARE(index.contactNames().value(local.id()), localName);
+    QCOMPARE(index.nicknames().count(), 1);
+    QCOMPARE(index.nicknames().value(QStringLiteral("Nick")), wasLocal.id());
+}
+
+void tst_LocalContactIndex::incremental()
+{
+    QContact changed(saveContact(QStringLiteral("local"), QStringLiteral("guid-1"), QStringLiteral("Changed")));
+    QContact moved(saveContact(QStringLiteral("local"), QStringLiteral("guid-2"), QStringLiteral("Moved")));
+    const QContact removed(saveContact(QStringLiteral("bluetooth"), QStringLiteral("guid-3"), QStringLiteral("Removed")));
+
+    SeasideLocalContactIndex index(&m_manager, SeasideLocalContactIndex::localContactFilter());
+    index.refresh();
+    QCOMPARE(index.guids().count(), 3);
+
+    // Modifications reported by the manager are applied by the next refresh
+    QContactName name(changed.detail<QContactName>());
+    name.setLastName(QStringLiteral("Renamed"));
+    changed.saveDetail(&name);
+    QVERIFY(m_manager.saveContact(&changed));
+
+    QContactSyncTarget target(moved.detail<QContactSyncTarget>());
+    target.setSyncTarget(QStringLiteral("other"));
+    moved.saveDetail(&target);
+    QVERIFY(m_manager.saveContact(&moved));
+
+    QVERIFY(m_manager.removeContact(removed.id()));
+
+    const QContact added(saveContact(QStringLiteral("was_local"), QStringLiteral("guid-4"), QStringLiteral("Added")));
+
+    index.refresh();
+
+    const QHash<QString, QContactId> guids(index.guids());
+    QCOMPARE(guids.count(), 2);
+    QCOMPARE(guids.value(QStringLiteral("guid-1")), changed.id());
+    QCOMPARE(guids.value(QStringLiteral("guid-4")), added.id());
+
+    const QHash<QString, QContactId> names(index.names());
+    QCOMPARE(names.count(), 2);
+    QCOMPARE(names.value(SeasideLocalContactIndex::contactNameString(changed)), changed.id());
+    QCOMPARE(names.value(SeasideLocalContactIndex::contactNameString(added)), added.id());
+    QCOMPARE(index.contactNames().value(changed.id()), SeasideLocalContactIndex::contactNameString(changed));
+    QVERIFY(!index.contactNames().contains(moved.id()));
+    QVERIFY(!index.contactNames().contains(removed.id()));
+}
+
+void tst_LocalContactIndex::sharedKeys()
+{
+    const QContact first(saveContact(QStringLiteral("local"), QString(), QStringLiteral("Shared"), QStringLiteral("Nick")));
+    const QContact second(saveContact(QStringLiteral("local"), QString(), QStringLiteral("Shared"), QStringLiteral("Nick")));
+    const QString name(SeasideLocalContactIndex::contactNameString(first));
+
+    SeasideLocalContactIndex index(&m_manager, SeasideLocalContactIndex::localContactFilter());
+    index.refresh();
+    QCOMPARE(index.names().count(), 1);
+    QCOMPARE(index.contactNames().count(), 2);
+
+    // Removing one holder of a key leaves the key held by the other
+    const QContactId removedId(index.names().value(name));
+    const QContactId keptId(removedId == first.id() ? second.id() : first.id());
+    QVERIFY(m_manager.removeContact(removedId));
+    index.invalidate(QList<QContactId>() << removedId);
+    index.refresh();
+
+    QCOMPARE(index.names().value(name), keptId);
+    QCOMPARE(index.nicknames().value(QStringLiteral("Nick")), keptId);
+
+    QVERIFY(m_manager.removeContact(keptId));
+    index.invalidate(QList<QContactId>() << keptId);
+    index.refresh();
+
+    QVERIFY(index.names().isEmpty());
+    QVERIFY(index.nicknames().isEmpty());
+}
+
+void tst_LocalContactIndex::stored()
+{
+    const QString path(m_dir.path() + QStringLiteral("/local-contact-index"));
+
+    const QContact kept(saveContact(QStringLiteral("local"), QStringLiteral("guid-1"), QStringLiteral("Kept")));
+    const QContact removed(saveContact(QStringLiteral("local"), QStringLiteral("guid-2"), QStringLiteral("Removed")));
+    QContact changed(saveContact(QStringLiteral("local"), QString(), QString(), QStringLiteral("Nick")));
+
+    {
+        SeasideLocalContactIndex index(&m_manager, SeasideLocalContactIndex::localContactFilter(), path);
+        index.refresh();
+        QCOMPARE(index.guids().count(), 2);
+    }
+    QVERIFY(QFile::exists(path));
+
+    // Modifications made while no index exists are found when the stored index is read
+    QVERIFY(m_manager.removeContact(removed.id()));
+
+    QContactNickname nick(changed.detail<QContactNickname>());
+    nick.setNickname(QStringLiteral("Renamed"));
+    changed.saveDetail(&nick);
+    QVERIFY(m_manager.saveContact(&changed));
+
+    const QContact added(saveContact(QStringLiteral("local"), QStringLiteral("guid-3"), QStringLiteral("Added")));
+
+    SeasideLocalContactIndex index(&m_manager, SeasideLocalContactIndex::localContactFilter(), path);
+    index.refresh();
+
+    const QHash<QString, QContactId> guids(index.guids());
+    QCOMPARE(guids.count(), 2);
+    QCOMPARE(guids.value(QStringLiteral("guid-1")), kept.id());
+    QCOMPARE(guids.value(QStringLiteral("guid-3")), added.id());
+
+    const QHash<QString, QContactId> nicknames(index.nicknames());
+    QCOMPARE(nicknames.count(), 1);
+    QCOMPARE(nicknames.value(QStringLiteral("Renamed")), changed.id());
+}
+
+#include "tst_localcontactindex.moc"
+QTEST_GUILESS_MAIN(tst_LocalContactIndex)
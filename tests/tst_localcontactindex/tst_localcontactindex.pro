@@ -0,0 +1,7 @@
+include(../../config.pri)
+include(../common.pri)
+TARGET = tst_localcontactindex
+
+SOURCES += tst_localcontactindex.cpp
+
+LIBS += ../../src/libcontactcache-qt5.so
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidecache.h"
+#include "seasidephonenumberindex.h"
+
+#include <QObject>
+#include <QtTest>
+
+#include <phonenumbers/phonenumberutil.h>
+
+using ::i18n::phonenumbers::PhoneNumberUtil;
+
+namespace {
+
+QString internationalNumber(int i)
+{
+    return QStringLiteral("+35840%1").arg(1000000 + i * 7, 7, 10, QLatin1Char('0'));
+}
+
+QString nationalNumber(int i)
+{
+    return QStringLiteral("040%1").arg(1000000 + i * 7, 7, 10, QLatin1Char('0'));
+}
+
+// The lookup previously performed by SeasideCache, for comparison
+class HashLookup
+{
+public:
+    void insert(const QString &number, quint32 iid)
+    {
+        const QString normalized(SeasideCache::normalizePhoneNumber(number));
+        m_numbers.insert(SeasideCache::minimizePhoneNumber(normalized), qMakePair(normalized, iid));
+        m_contactNumbers.insert(iid, number);
+    }
+
+    quint32 find(const QString &number) const
+    {
+        const QString normalized(SeasideCache::normalizePhoneNumber(number));
+        const QString minimized(SeasideCache::minimizePhoneNumber(normalized));
+
+        QHash<QString, quint32> possibleMatches;
+        PhoneNumberUtil *util = PhoneNumberUtil::GetInstance();
+        const std::string normalizedStdStr(normalized.toStdString());
+
+        QMultiHash<QString, QPair<QString, quint32> >::const_iterator it = m_numbers.find(minimized), end = m_numbers.constEnd();
+        for ( ; it != end && it.key() == minimized; ++it) {
+            if (it->first == normalized)
+                return it->second;
+
+            switch (util->IsNumberMatchWithTwoStrings(normalizedStdStr, it->first.toStdString())) {
+            case PhoneNumberUtil::EXACT_MATCH:
+                return it->second;
+            case PhoneNumberUtil::NSN_MATCH:
+            case PhoneNumberUtil::SHORT_NSN_MATCH:
+                possibleMatches.insert(it->first, it->second);
+                break;
+            default:
+                break;
+            }
+        }
+
+        int bestMatchLength = 0;
+        quint32 bestMatch = 0;
+        for (QHash<QString, quint32>::const_iterator match = possibleMatches.constBegin(); match != possibleMatches.constEnd(); ++match) {
+            // Each number of the contact was normalized again to measure the match
+            foreach (const QString &contactNumber, m_contactNumbers.values(*match)) {
+                const QString contactNormalized(SeasideCache::normalizePhoneNumber(contactNumber));
+                int length = 0;
+                while (length < contactNormalized.length() && length < normalized.length() &&
+                       contactNormalized.at(contactNormalized.length() - length - 1) == normalized.at(normalized.length() - length - 1)) {
+                    ++length;
+                }
+                if (length > bestMatchLength) {
+                    bestMatchLength = length;
+                    bestMatch = *match;
+                }
+            }
+        }
+        return bestMatch;
+    }
+
+private:
+    QMultiHash<QString, QPair<QString, quint32> > m_numbers;
+    QMultiHash<quint32, QString> m_contactNumbers;
+};
+
+void indexNumber(SeasidePhoneNumberIndex *index, const QString &number, quint32 iid)
+{
+    const QString normalized(SeasideCache::normalizePhoneNumber(number));
+    if (normalized.startsWith(QLatin1Char('+')))
+        index->insert(normalized, normalized, iid);
+    index->insert(SeasideCache::minimizePhoneNumber(normalized), normalized, iid);
+}
+
+SeasidePhoneNumberIndex::Match findNumber(const SeasidePhoneNumberIndex &index, const QString &number)
+{
+    const QString normalized(SeasideCache::normalizePhoneNumber(number));
+    if (normalized.startsWith(QLatin1Char('+'))) {
+        const SeasidePhoneNumberIndex::Match match(index.find(normalized, normalized));
+        if (match.iid)
+            return match;
+    }
+    return index.find(SeasideCache::minimizePhoneNumber(normalized), normalized);
+}
+
+}
+
+class tst_PhoneNumberIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void exactMatch();
+    void nationalMatch();
+    void noMatch();
+    void remove();
+    void removeSharedKey();
+    void removeAndReinsert();
+    void normalizedNumbers();
+    void lookup_data();
+    void lookup();
+};
+
+void tst_PhoneNumberIndex::exactMatch()
+{
+    SeasidePhoneNumberIndex index;
+    indexNumber(&index, QStringLiteral("+358401234567"), 1);
+    indexNumber(&index, QStringLiteral("+358407654321"), 2);
+
+    const SeasidePhoneNumberIndex::Match match(findNumber(index, QStringLiteral("+358401234567")));
+    QCOMPARE(match.iid, 1u);
+    QVERIFY(match.exact);
+    QCOMPARE(findNumber(index, QStringLiteral("+358407654321")).iid, 2u);
+}
+
+void tst_PhoneNumberIndex::nationalMatch()
+{
+    SeasidePhoneNumberIndex index;
+    indexNumber(&index, QStringLiteral("+358401234567"), 1);
+
+    // The national form of the number matches by its NSN
+    const SeasidePhoneNumberIndex::Match match(findNumber(index, QStringLiteral("0401234567")));
+    QCOMPARE(match.iid, 1u);
+    QVERIFY(!match.exact);
+}
+
+void tst_PhoneNumberIndex::noMatch()
+{
+    SeasidePhoneNumberIndex index;
+    indexNumber(&index, QStringLiteral("+358401234567"), 1);
+
+    QCOMPARE(findNumber(index, QStringLiteral("+358409999999")).iid, 0u);
+    QCOMPARE(findNumber(index, QStringLiteral("+14151234567")).iid, 0u);
+    QVERIFY(!index.contains(QStringLiteral("9999999")));
+}
+
+void tst_PhoneNumberIndex::remove()
+{
+    SeasidePhoneNumberIndex index;
+    indexNumber(&index, QStringLiteral("+358401234567"), 1);
+    indexNumber(&index, QStringLiteral("+358401234567"), 2);
+    QCOMPARE(index.count(), 4);
+
+    const QString normalized(SeasideCache::normalizePhoneNumber(QStringLiteral("+358401234567")));
+    const QString minimized(SeasideCache::minimizePhoneNumber(normalized));
+    index.remove(normalized, normalized, 1);
+    index.remove(minimized, normalized, 1);
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(findNumber(index, QStringLiteral("+358401234567")).iid, 2u);
+
+    index.remove(normalized, normalized, 2);
+    index.remove(minimized, normalized, 2);
+    QCOMPARE(index.count(), 0);
+    QVERIFY(!index.contains(minimized));
+    QCOMPARE(findNumber(index, QStringLiteral("+358401234567")).iid, 0u);
+}
+
+void tst_PhoneNumberIndex::removeSharedKey()
+{
+    // Both numbers of the contact are indexed under the same minimized key
+    SeasidePhoneNumberIndex index;
+    indexNumber(&index, QStringLiteral("+358401234567"), 1);
+    indexNumber(&index, QStringLiteral("0401234567"), 1);
+    QCOMPARE(index.count(), 3);
+
+    const QString normalized(SeasideCache::normalizePhoneNumber(QStringLiteral("+358401234567")));
+    index.remove(normalized, normalized, 1);
+    index.remove(SeasideCache::minimizePhoneNumber(normalized), normalized, 1);
+    QCOMPARE(index.count(), 1);
+
+    // The other number remains indexed
+    const SeasidePhoneNumberIndex::Match match(findNumber(index, QStringLiteral("0401234567")));
+    QCOMPARE(match.iid, 1u);
+    QVERIFY(match.exact);
+}
+
+void tst_PhoneNumberIndex::removeAndReinsert()
+{
+    SeasidePhoneNumberIndex index;
+    for (int i = 0; i < 200; ++i)
+        indexNumber(&index, internationalNumber(i), i + 1);
+
+    // Removing the odd numbers prunes the nodes which lead only to them
+    for (int i = 1; i < 200; i += 2) {
+        const QString normalized(SeasideCache::normalizePhoneNumber(internationalNumber(i)));
+        index.remove(normalized, normalized, i + 1);
+        index.remove(SeasideCache::minimizePhoneNumber(normalized), normalized, i + 1);
+    }
+    QCOMPARE(index.count(), 200);
+
+    for (int i = 0; i < 200; ++i) {
+        QCOMPARE(findNumber(index, internationalNumber(i)).iid, (i % 2) ? 0u : quint32(i + 1));
+    }
+
+    // New numbers reuse the pruned nodes
+    for (int i = 1; i < 200; i += 2)
+        indexNumber(&index, internationalNumber(i + 1000), i + 1001);
+    QCOMPARE(index.count(), 400);
+
+    for (int i = 0; i < 200; ++i) {
+        QCOMPARE(findNumber(index, internationalNumber(i)).iid, (i % 2) ? 0u : quint32(i + 1));
+        if (i % 2)
+            QCOMPARE(findNumber(index, internationalNumber(i + 1000)).iid, quint32(i + 1001));
+    }
+}
+
+void tst_PhoneNumberIndex::normalizedNumbers()
+{
+    SeasidePhoneNumberIndex index;
+    indexNumber(&index, QStringLiteral("+358401234567"), 1);
+    indexNumber(&index, QStringLiteral("0401234567"), 1);
+    indexNumber(&index, QStringLiteral("+358407654321"), 2);
+
+    const QString international(SeasideCache::normalizePhoneNumber(QStringLiteral("+358401234567")));
+    const QString national(SeasideCache::normalizePhoneNumber(QStringLiteral("0401234567")));
+
+    // Each number is reported once, although it is indexed under several keys
+    QStringList numbers(index.normalizedNumbers(1));
+    numbers.sort();
+    QCOMPARE(numbers, QStringList() << international << national);
+
+    index.remove(international, international, 1);
+    QCOMPARE(index.normalizedNumbers(1).count(), 2);
+    index.remove(SeasideCache::minimizePhoneNumber(international), international, 1);
+    QCOMPARE(index.normalizedNumbers(1), QStringList() << national);
+
+    index.clear();
+    QVERIFY(index.normalizedNumbers(2).isEmpty());
+}
+
+void tst_PhoneNumberIndex::lookup_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("useIndex");
+
+    QTest::newRow("hash 10k") << 10000 << false;
+    QTest::newRow("index 10k") << 10000 << true;
+    QTest::newRow("hash 50k") << 50000 << false;
+    QTest::newRow("index 50k") << 50000 << true;
+}
+
+void tst_PhoneNumberIndex::lookup()
+{
+    QFETCH(int, count);
+    QFETCH(bool, useIndex);
+
+    SeasidePhoneNumberIndex index;
+    HashLookup hash;
+    for (int i = 0; i < count; ++i) {
+        if (useIndex) {
+            indexNumber(&index, internationalNumber(i), i + 1);
+        } else {
+            hash.insert(internationalNumber(i), i + 1);
+        }
+    }
+
+    // Incoming calls commonly present the number in national form
+    QStringList queries;
+    for (int i = 0; i < 100; ++i)
+        queries.append(nationalNumber((i * 97) % count));
+
+    QBENCHMARK {
+        foreach (const QString &query, queries) {
+            const quint32 iid = useIndex ? findNumber(index, query).iid : hash.find(query);
+            QVERIFY(iid != 0);
+        }
+    }
+}
+
+#include "tst_phonenumberindex.moc"
+QTEST_APPLESS_MAIN(tst_PhoneNumberIndex)
@@ -0,0 +1,7 @@
+include(../../config.pri)
+include(../common.pri)
+TARGET = tst_phonenumberindex
+
+SOURCES += tst_phonenumberindex.cpp
+
+LIBS += ../../src/libcontactcache-qt5.so -lphonenumber
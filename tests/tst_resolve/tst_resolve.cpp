@@ -66,8 +66,10 @@ private slots:
     void resolveByPhoneNotFound();
     void resolveByEmail();
     void resolveByEmailNotFound();
+    void resolveKnownUnknown();
     void resolveByAccount();
     void resolveByAccountNotFound();
+    void resolveBatch();
 
     void resolveDuringContactLink();
 };
@@ -85,6 +87,13 @@ struct TestResolveListener : public SeasideCache::ResolveListener {
     SeasideCache::CacheItem *m_item;
 };
 
+struct TestBatchResolveListener : public SeasideCache::ResolveListener {
+    virtual void addressResolved(const QString &first, const QString &second, SeasideCache::CacheItem *item)
+        { m_resolved.insert(first.isEmpty() ? second : first, item); }
+
+    QHash<QString, SeasideCache::CacheItem *> m_resolved;
+};
+
 } // anonymous
 
 void tst_Resolve::initTestCase()
@@ -286,6 +295,27 @@ void tst_Resolve::resolveByEmailNotFound()
     QCOMPARE(item, (SeasideCache::CacheItem *)0);
 }
 
+void tst_Resolve::resolveKnownUnknown()
+{
+    TestResolveListener listener;
+    QString address("unknown@example.com");
+
+    QVERIFY(!SeasideCache::resolveEmailAddress(&listener, address, true));
+    QTRY_VERIFY(listener.m_resolved);
+    QCOMPARE(listener.m_item, (SeasideCache::CacheItem *)0);
+
+    // The second resolution should be answered from the negative cache, regardless of case
+    const int hits = SeasideCache::unknownAddressHits();
+    TestResolveListener repeatListener;
+    QVERIFY(!SeasideCache::resolveEmailAddress(&repeatListener, address.toUpper(), true));
+    QTRY_VERIFY(repeatListener.m_resolved);
+    QCOMPARE(repeatListener.m_item, (SeasideCache::CacheItem *)0);
+    QCOMPARE(SeasideCache::unknownAddressHits(), hits + 1);
+
+    SeasideCache::unregisterResolveListener(&listener);
+    SeasideCache::unregisterResolveListener(&repeatListener);
+}
+
 void tst_Resolve::resolveByAccount()
 {
     SeasideCache::CacheItem *item;
@@ -317,6 +347,34 @@ void tst_Resolve::resolveByAccountNotFound()
     QCOMPARE(item, (SeasideCache::CacheItem *)0);
 }
 
+void tst_Resolve::resolveBatch()
+{
+    TestBatchResolveListener listener;
+
+    const QStringList numbers(QStringList() << "+358474005000" << "+358471112222" << "+44123456789");
+    const QStringList addresses(QStringList() << "alfred@alfred.com" << "daffy.d@example.com" << "nobody@example.com");
+
+    SeasideCache::resolvePhoneNumbers(&listener, numbers, true);
+    SeasideCache::resolveEmailAddresses(&listener, addresses, true);
+
+    // Every address is reported, whether or not it is found
+    QTRY_COMPARE(listener.m_resolved.count(), numbers.count() + addresses.count());
+
+    QVERIFY(listener.m_resolved.value("+358474005000"));
+    QCOMPARE(listener.m_resolved.value("+358474005000")->contact.detail<QContactName>().firstName(), QString::fromLatin1("Alfred"));
+    QVERIFY(listener.m_resolved.value("+358471112222"));
+    QCOMPARE(listener.m_resolved.value("+358471112222")->contact.detail<QContactName>().firstName(), QString::fromLatin1("Carlo"));
+    QCOMPARE(listener.m_resolved.value("+44123456789"), (SeasideCache::CacheItem *)0);
+
+    QVERIFY(listener.m_resolved.value("alfred@alfred.com"));
+    QCOMPARE(listener.m_resolved.value("alfred@alfred.com")->contact.detail<QContactName>().firstName(), QString::fromLatin1("Alfred"));
+    QVERIFY(listener.m_resolved.value("daffy.d@example.com"));
+    QCOMPARE(listener.m_resolved.value("daffy.d@example.com")->contact.detail<QContactName>().firstName(), QString::fromLatin1("Dafferd"));
+    QCOMPARE(listener.m_resolved.value("nobody@example.com"), (SeasideCache::CacheItem *)0);
+
+    SeasideCache::unregisterResolveListener(&listener);
+}
+
 struct ItemWatcher : public SeasideCache::ItemData {
     QList<int> m_constituents;
     bool m_aggregationComplete;
@@ -17,4 +17,22 @@ SOURCES += ../../src/seasidecache.cpp
 HEADERS += ../../src/cacheconfiguration.h
 SOURCES += ../../src/cacheconfiguration.cpp
 
+HEADERS += ../../src/seasidedialpadindex.h
+SOURCES += ../../src/seasidedialpadindex.cpp
+
+HEADERS += ../../src/seasideexportjob.h
+SOURCES += ../../src/seasideexportjob.cpp
+
+HEADERS += ../../src/seasideimportjob.h
+SOURCES += ../../src/seasideimportjob.cpp
+
+HEADERS += ../../src/seasidelocalcontactindex.h
+SOURCES += ../../src/seasidelocalcontactindex.cpp
+
+HEADERS += ../../src/seasidephonenumberindex.h
+SOURCES += ../../src/seasidephonenumberindex.cpp
+
+HEADERS += ../../src/seasidesearchindex.h
+SOURCES += ../../src/seasidesearchindex.cpp
+
 SOURCES += tst_resolve.cpp
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * "Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Nemo Mobile nor the names of its contributors
+ *     may be used to endorse or promote products derived from this
+ *     software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE."
+ */
+
+
+#include "seasidesearchindex.h"
+
+#include <QObject>
+#include <QtTest>
+
+namespace {
+
+const char *const firstNames[] = { "Aino", "Matti", "Élodie", "Jörg", "Sanna", "Pekka", "Zoë", "Björn" };
+const char *const lastNames[] = { "Virtanen", "Korhonen", "Nieminen", "Mäkinen", "Hämäläinen", "Laine", "Heikkinen", "Koskinen" };
+
+QStringList contactText(int i)
+{
+    const QString firstName(QString::fromUtf8(firstNames[i % 8]));
+    const QString lastName(QString::fromUtf8(lastNames[(i / 8) % 8]));
+
+    return QStringList() << (firstName + QLatin1Char(' ') + lastName)
+                         << firstName
+                         << lastName
+                         << QStringLiteral("contact%1@example.com").arg(i)
+                         << QStringLiteral("+35840%1").arg(i, 7, 10, QLatin1Char('0'));
+}
+
+}
+
+class tst_SearchIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void tokenize();
+    void prefixMatch();
+    void allTokensMatch();
+    void update();
+    void remove();
+    void search_data();
+    void search();
+};
+
+void tst_SearchIndex::tokenize()
+{
+    QCOMPARE(SeasideSearchIndex::tokenize(QString::fromUtf8("Élodie Mäkinen-Laine")),
+             QStringList() << QStringLiteral("elodie") << QStringLiteral("makinen") << QStringLiteral("laine"));
+    QCOMPARE(SeasideSearchIndex::tokenize(QStringLiteral("aino.virtanen@example.com")),
+             QStringList() << QStringLiteral("aino") << QStringLiteral("virtanen") << QStringLiteral("example") << QStringLiteral("com"));
+    QCOMPARE(SeasideSearchIndex::tokenize(QStringLiteral("  ")), QStringList());
+}
+
+void tst_SearchIndex::prefixMatch()
+{
+    SeasideSearchIndex index;
+    index.insert(2, QStringList() << QString::fromUtf8("Jörg Mäkinen"));
+    index.insert(1, QStringList() << QStringLiteral("Matti Korhonen"));
+    index.insert(3, QStringList() << QStringLiteral("Sanna Laine"));
+
+    QCOMPARE(index.search(QStringLiteral("ma")), QList<quint32>() << 1 << 2);
+    QCOMPARE(index.search(QString::fromUtf8("MÄK")), QList<quint32>() << 2);
+    QCOMPARE(index.search(QStringLiteral("jorg")), QList<quint32>() << 2);
+    QCOMPARE(index.search(QStringLiteral("x")), QList<quint32>());
+    QCOMPARE(index.search(QString()), QList<quint32>());
+}
+
+void tst_SearchIndex::allTokensMatch()
+{
+    SeasideSearchIndex index;
+    index.insert(1, QStringList() << QStringLiteral("Matti Korhonen"));
+    index.insert(2, QStringList() << QStringLiteral("Matti Laine"));
+    index.insert(3, QStringList() << QStringLiteral("Sanna Laine"));
+
+    QCOMPARE(index.search(QStringLiteral("la m")), QList<quint32>() << 2);
+    QCOMPARE(index.search(QStringLiteral("laine")), QList<quint32>() << 2 << 3);
+    QCOMPARE(index.search(QStringLiteral("sanna korhonen")), QList<quint32>());
+}
+
+void tst_SearchIndex::update()
+{
+    SeasideSearchIndex index;
+    index.insert(1, QStringList() << QStringLiteral("Matti Korhonen"));
+    index.insert(1, QStringList() << QStringLiteral("Matti Laine") << QStringLiteral("matti@example.com"));
+
+    QCOMPARE(index.count(), 1);
+    QCOMPARE(index.search(QStringLiteral("korhonen")), QList<quint32>());
+    QCOMPARE(index.search(QStringLiteral("laine")), QList<quint32>() << 1);
+    QCOMPARE(index.search(QStringLiteral("example")), QList<quint32>() << 1);
+
+    // A contact without searchable text is not indexed
+    index.insert(1, QStringList() << QString());
+    QCOMPARE(index.count(), 0);
+    QVERIFY(!index.contains(1));
+}
+
+void tst_SearchIndex::remove()
+{
+    SeasideSearchIndex index;
+    index.insert(1, QStringList() << QStringLiteral("Matti Korhonen"));
+    index.insert(2, QStringList() << QStringLiteral("Matti Laine"));
+
+    index.remove(1);
+    QCOMPARE(index.count(), 1);
+    QVERIFY(!index.contains(1));
+    QCOMPARE(index.search(QStringLiteral("matti")), QList<quint32>() << 2);
+
+    index.clear();
+    QCOMPARE(index.count(), 0);
+    QCOMPARE(index.search(QStringLiteral("matti")), QList<quint32>());
+}
+
+void tst_SearchIndex::search_data()
+{
+    QTest::addColumn<QString>("query");
+
+    QTest::newRow("single character") << QStringLiteral("m");
+    QTest::newRow("name prefix") << QStringLiteral("kor");
+    QTest::newRow("two tokens") << QString::fromUtf8("ma hä");
+    QTest::newRow("email") << QStringLiteral("contact123");
+}
+
+void tst_SearchIndex::search()
+{
+    QFETCH(QString, query);
+
+    SeasideSearchIndex index;
+    for (int i = 0; i < 10000; ++i) {
+        index.insert(i + 1, contactText(i));
+    }
+
+    QBENCHMARK {
+        QVERIFY(!index.search(query).isEmpty());
+    }
+}
+
+#include "tst_searchindex.moc"
+QTEST_APPLESS_MAIN(tst_SearchIndex)
@@ -0,0 +1,7 @@
+include(../../config.pri)
+include(../common.pri)
+TARGET = tst_searchindex
+
+SOURCES += tst_searchindex.cpp
+
+LIBS += ../../src/libcontactcache-qt5.so
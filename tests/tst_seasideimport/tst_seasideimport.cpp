@@ -31,18 +31,31 @@
 
 #include "seasideimport.h"
 
+#include <QContactAvatar>
+#include <QContactEmailAddress>
 #include <QContactGuid>
 #include <QContactName>
 #include <QContactNickname>
 #include <QContactPhoneNumber>
+#include <QContactSyncTarget>
 
 #include <QVersitReader>
 
 #include <QObject>
+#include <QSignalSpy>
 #include <QtTest>
 
 QTVERSIT_USE_NAMESPACE
 
+class MemoryContactBuilder : public SeasideContactBuilder
+{
+public:
+    explicit MemoryContactBuilder(QContactManager *manager)
+    {
+        d->manager = manager;
+    }
+};
+
 class tst_SeasideImport : public QObject
 {
     Q_OBJECT
@@ -65,6 +78,15 @@ private slots:
     void mergedName();
     void mergedNickname();
     void mergedUid();
+    void mergedDetails();
+    void mergedExisting();
+
+    void parallelConversion();
+    void sharedAvatar();
+    void corruptAvatar();
+
+    void progress();
+    void cancelled();
 };
 
 
@@ -498,5 +520,215 @@ void tst_SeasideImport::mergedUid()
     QCOMPARE(guid.guid(), QString::fromLatin1("uid-1"));
 }
 
+void tst_SeasideImport::mergedDetails()
+{
+    // Details already present are not duplicated, but subsets of them are not added either
+    const char *vCardData =
+"BEGIN:VCARD\r\n"
+"N:Springfield;Jebediah;;;\r\n"
+"TEL;VOICE:555-1234\r\n"
+"TEL;TYPE=CELL:555-6789\r\n"
+"EMAIL:jeb@example.com\r\n"
+"END:VCARD\r\n"
+"BEGIN:VCARD\r\n"
+"N:Springfield;Jebediah;;;\r\n"
+"TEL;VOICE:555-1234\r\n"
+"TEL:555-6789\r\n"
+"TEL:555-0000\r\n"
+"EMAIL:jeb@example.com\r\n"
+"EMAIL:jebediah@example.com\r\n"
+"END:VCARD\r\n";
+
+    const QList<QContact> contacts(processVCard(vCardData));
+    QCOMPARE(contacts.count(), 1);
+
+    const QContact &c(contacts.at(0));
+
+    QStringList numbers;
+    foreach (const QContactPhoneNumber &phone, c.details<QContactPhoneNumber>())
+        numbers.append(phone.number());
+    numbers.sort();
+    QCOMPARE(numbers, QStringList() << QString::fromLatin1("555-0000") << QString::fromLatin1("555-1234") << QString::fromLatin1("555-6789"));
+
+    QStringList addresses;
+    foreach (const QContactEmailAddress &email, c.details<QContactEmailAddress>())
+        addresses.append(email.emailAddress());
+    addresses.sort();
+    QCOMPARE(addresses, QStringList() << QString::fromLatin1("jeb@example.com") << QString::fromLatin1("jebediah@example.com"));
+}
+
+void tst_SeasideImport::mergedExisting()
+{
+    // Enough matches that the existing contacts are fetched in several chunks
+    QContactManager manager(QStringLiteral("memory"));
+
+    QList<QContact> existing;
+    for (int i = 0; i < 450; ++i) {
+        QContactSyncTarget syncTarget;
+        syncTarget.setSyncTarget(QStringLiteral("local"));
+
+        QContactName name;
+        name.setFirstName(QStringLiteral("Jebediah"));
+        name.setLastName(QStringLiteral("Springfield%1").arg(i));
+
+        QContact contact;
+        contact.saveDetail(&syncTarget);
+        contact.saveDetail(&name);
+        existing.append(contact);
+    }
+    QVERIFY(manager.saveContacts(&existing));
+
+    QByteArray vCardData;
+    for (int i = 0; i < 450; ++i) {
+        vCardData += "BEGIN:VCARD\r\n";
+        vCardData += QStringLiteral("N:Springfield%1;Jebediah;;;\r\n").arg(i).toUtf8();
+        vCardData += QStringLiteral("TEL;VOICE:555-%1\r\n").arg(i, 4, 10, QLatin1Char('0')).toUtf8();
+        vCardData += "END:VCARD\r\n";
+    }
+
+    QVersitReader reader(vCardData);
+    QVERIFY(reader.startReading() && reader.waitForFinished());
+
+    MemoryContactBuilder builder(&manager);
+    int newCount = -1;
+    int updatedCount = -1;
+    const QList<QContact> contacts(SeasideImport::buildImportContacts(reader.results(), &newCount, &updatedCount, 0, &builder));
+    QCOMPARE(newCount, 0);
+    QCOMPARE(updatedCount, 450);
+    QCOMPARE(contacts.count(), 450);
+
+    QHash<QString, QContactId> existingIds;
+    foreach (const QContact &contact, existing)
+        existingIds.insert(contact.detail<QContactName>().lastName(), contact.id());
+
+    foreach (const QContact &contact, contacts) {
+        QCOMPARE(contact.id(), existingIds.value(contact.detail<QContactName>().lastName()));
+        QCOMPARE(contact.details<QContactPhoneNumber>().count(), 1);
+    }
+}
+
+void tst_SeasideImport::parallelConversion()
+{
+    QByteArray vCardData;
+    for (int i = 0; i < 300; ++i) {
+        vCardData += "BEGIN:VCARD\r\n";
+        vCardData += QStringLiteral("N:Springfield%1;Jebediah;;;\r\n").arg(i).toUtf8();
+        vCardData += QStringLiteral("TEL;VOICE:555-%1\r\n").arg(i, 4, 10, QLatin1Char('0')).toUtf8();
+        vCardData += "END:VCARD\r\n";
+    }
+
+    QVersitReader reader(vCardData);
+    QVERIFY(reader.startReading() && reader.waitForFinished());
+    const QList<QVersitDocument> documents(reader.results());
+    QCOMPARE(documents.count(), 300);
+
+    SeasideContactBuilder sequentialBuilder;
+    const QList<QContact> sequential(sequentialBuilder.importContacts(documents));
+
+    SeasideContactBuilder parallelBuilder;
+    parallelBuilder.setConversionThreadCount(4);
+    const QList<QContact> parallel(parallelBuilder.importContacts(documents));
+
+    // The shards are reassembled in document order
+    QCOMPARE(parallel.count(), sequential.count());
+    for (int i = 0; i < parallel.count(); ++i) {
+        QCOMPARE(parallel.at(i).detail<QContactName>().lastName(), QStringLiteral("Springfield%1").arg(i));
+        QCOMPARE(parallel.at(i).detail<QContactPhoneNumber>().number(),
+                 sequential.at(i).detail<QContactPhoneNumber>().number());
+    }
+}
+
+void tst_SeasideImport::sharedAvatar()
+{
+    // Two contacts with the same photo should refer to a single saved image
+    const char *vCardData =
+"BEGIN:VCARD\r\n"
+"VERSION:3.0\r\n"
+"N:Springfield;Jebediah;;;\r\n"
+"PHOTO;ENCODING=b;TYPE=PNG:iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAADUlEQVR42mNk+M9QDwADhgGAWjR9awAAAABJRU5ErkJggg==\r\n"
+"END:VCARD\r\n"
+"BEGIN:VCARD\r\n"
+"VERSION:3.0\r\n"
+"N:Shelbyville;Jebediah;;;\r\n"
+"PHOTO;ENCODING=b;TYPE=PNG:iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAADUlEQVR42mNk+M9QDwADhgGAWjR9awAAAABJRU5ErkJggg==\r\n"
+"END:VCARD\r\n";
+
+    const QList<QContact> contacts(processVCard(vCardData));
+    QCOMPARE(contacts.count(), 2);
+
+    const QUrl avatarUrl(contacts.at(0).detail<QContactAvatar>().imageUrl());
+    QVERIFY(avatarUrl.isLocalFile());
+    QCOMPARE(contacts.at(1).detail<QContactAvatar>().imageUrl(), avatarUrl);
+
+    // The image has been saved by the time the contacts are returned
+    QVERIFY(QFile::exists(avatarUrl.toLocalFile()));
+}
+
+void tst_SeasideImport::corruptAvatar()
+{
+    // The PNG header is valid, but the image data cannot be decoded
+    const char *vCardData =
+"BEGIN:VCARD\r\n"
+"VERSION:3.0\r\n"
+"N:Springfield;Jebediah;;;\r\n"
+"PHOTO;ENCODING=b;TYPE=PNG:iVBORw0KGgoAAAANSUhEUgAAAAEAAAABCAYAAAAfFcSJAAAADUlEQVT/////////////////AAAAAA==\r\n"
+"END:VCARD\r\n";
+
+    const QList<QContact> contacts(processVCard(vCardData));
+    QCOMPARE(contacts.count(), 1);
+
+    // No avatar refers to an image which was never saved
+    QVERIFY(contacts.at(0).details<QContactAvatar>().isEmpty());
+}
+
+void tst_SeasideImport::progress()
+{
+    QByteArray vCardData;
+    for (int i = 0; i < 600; ++i) {
+        vCardData += "BEGIN:VCARD\r\n";
+        vCardData += QStringLiteral("N:Springfield%1;Jebediah;;;\r\n").arg(i % 300).toUtf8();
+        vCardData += "END:VCARD\r\n";
+    }
+
+    QVersitReader reader(vCardData);
+    QVERIFY(reader.startReading() && reader.waitForFinished());
+
+    SeasideImportProgress progress;
+    QSignalSpy progressSpy(&progress, SIGNAL(progressChanged()));
+
+    int newCount = -1;
+    int ignoredCount = -1;
+    const QList<QContact> contacts(SeasideImport::buildImportContacts(reader.results(), &newCount, 0, &ignoredCount, 0, &progress));
+    QCOMPARE(contacts.count(), 300);
+    QCOMPARE(newCount, 300);
+    QCOMPARE(ignoredCount, 300);
+
+    // Each phase is reported as it starts, and the last once it is complete
+    QVERIFY(progressSpy.count() >= 7);
+    QCOMPARE(progress.phase(), SeasideImportProgress::Finished);
+    QCOMPARE(progress.itemsProcessed(), progress.itemsTotal());
+    QVERIFY(!progress.isCancelled());
+}
+
+void tst_SeasideImport::cancelled()
+{
+    const char *vCardData =
+"BEGIN:VCARD\r\n"
+"N:Springfield;Jebediah;;;\r\n"
+"END:VCARD\r\n";
+
+    QVersitReader reader(QByteArray(vCardData));
+    QVERIFY(reader.startReading() && reader.waitForFinished());
+
+    SeasideImportProgress progress;
+    progress.cancel();
+
+    int newCount = -1;
+    const QList<QContact> contacts(SeasideImport::buildImportContacts(reader.results(), &newCount, 0, 0, 0, &progress));
+    QCOMPARE(contacts.count(), 0);
+    QCOMPARE(newCount, 0);
+    QCOMPARE(progress.phase(), SeasideImportProgress::Cancelled);
+}
+
 #include "tst_seasideimport.moc"
 QTEST_GUILESS_MAIN(tst_SeasideImport)
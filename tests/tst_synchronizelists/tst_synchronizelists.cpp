@@ -34,6 +34,8 @@
 
 #include "synchronizelists.h"
 
+#include <algorithm>
+
 
 class tst_SynchronizeLists : public QObject
 {
@@ -45,6 +47,7 @@ public:
     bool m_filterEnabled;
     QVector<quint32> m_filter;
     QVector<quint32> m_cache;
+    mutable int m_filterCalls;
 
     bool filterValue(quint32 contactId) const;
     int insertRange(int index, int count, const QVector<quint32> &source, int sourceIndex);
@@ -55,20 +58,82 @@ private slots:
     void filtered();
     void unfiltered_data();
     void unfiltered();
+    void filteredAnchored_data() { filtered_data(); }
+    void filteredAnchored();
+    void unfilteredAnchored_data() { unfiltered_data(); }
+    void unfilteredAnchored();
+    void incremental_data();
+    void incremental();
+    void filteredIncremental_data() { incremental_data(); }
+    void filteredIncremental();
+    void perturbed_data();
+    void perturbed();
+    void moves_data();
+    void moves();
+    void movesIncremental_data();
+    void movesIncremental();
 };
 
 typedef QVector<quint32> List;
 
 Q_DECLARE_METATYPE(List)
 
+namespace {
+
+struct MovingAgent
+{
+    MovingAgent(const List &cache) : cache(cache), inserted(0), removed(0), moved(0), moveRanges(0) {}
+
+    int insertRange(int index, int count, const List &source, int sourceIndex)
+    {
+        for (int i = 0; i < count; ++i)
+            cache.insert(index + i, source.at(sourceIndex + i));
+        inserted += count;
+        return count;
+    }
+
+    int removeRange(int index, int count)
+    {
+        cache.remove(index, count);
+        removed += count;
+        return 0;
+    }
+
+    void moveRange(int index, int count, int destination)
+    {
+        // As for beginMoveRows(), the destination must not be within the moved range
+        QVERIFY(destination < index || destination > index + count);
+        QVERIFY(destination <= cache.count());
+
+        const List items(cache.mid(index, count));
+        cache.remove(index, count);
+        const int target = (destination > index) ? destination - count : destination;
+        for (int i = 0; i < count; ++i)
+            cache.insert(target + i, items.at(i));
+        moved += count;
+        ++moveRanges;
+    }
+
+    List cache;
+    int inserted;
+    int removed;
+    int moved;
+    int moveRanges;
+};
+
+}
+
 
 tst_SynchronizeLists::tst_SynchronizeLists()
+    : m_filterEnabled(false)
+    , m_filterCalls(0)
 {
     qRegisterMetaType<List>();
 }
 
 bool tst_SynchronizeLists::filterValue(quint32 contactId) const
 {
+    ++m_filterCalls;
     return !m_filterEnabled || m_filter.contains(contactId);
 }
 
@@ -290,5 +355,277 @@ void tst_SynchronizeLists::unfiltered()
     QCOMPARE(m_cache, reference);
 }
 
+void tst_SynchronizeLists::filteredAnchored()
+{
+    QFETCH(QVector<quint32>, reference);
+    QFETCH(QVector<quint32>, original);
+    QFETCH(QVector<quint32>, expected);
+
+    m_filterEnabled = true;
+    m_cache = original;
+    m_filter = expected;
+
+    synchronizeFilteredList<AnchoredSynchronizeList>(this, m_cache, reference);
+
+    QCOMPARE(m_cache, expected);
+}
+
+void tst_SynchronizeLists::unfilteredAnchored()
+{
+    QFETCH(QVector<quint32>, reference);
+    QFETCH(QVector<quint32>, original);
+
+    m_filterEnabled = false;
+    m_cache = original;
+
+    synchronizeList<AnchoredSynchronizeList>(this, m_cache, reference);
+
+    QCOMPARE(m_cache, reference);
+}
+
+enum Engine {
+    ScanningEngine,
+    AnchoredEngine
+};
+
+enum Perturbation {
+    Swaps,
+    Moves,
+    Reversal,
+    Shuffle
+};
+
+// A deterministic sequence, so that each run measures the same changes
+static quint32 nextRandom(quint32 *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 8);
+}
+
+static List perturbedList(const List &reference, Perturbation perturbation)
+{
+    List list(reference);
+    quint32 state = 1;
+
+    switch (perturbation) {
+    case Swaps:
+        for (int i = 0; i < list.count() / 100; ++i)
+            qSwap(list[nextRandom(&state) % list.count()], list[nextRandom(&state) % list.count()]);
+        break;
+    case Moves:
+        for (int i = 0; i < list.count() / 10; ++i) {
+            const quint32 value = list.takeAt(nextRandom(&state) % list.count());
+            list.insert(nextRandom(&state) % list.count(), value);
+        }
+        break;
+    case Reversal:
+        std::reverse(list.begin(), list.end());
+        break;
+    case Shuffle:
+        for (int i = list.count() - 1; i > 0; --i)
+            qSwap(list[i], list[nextRandom(&state) % (i + 1)]);
+        break;
+    }
+
+    // Remove some items, and add some which are not in the reference list
+    for (int i = 0; i < list.count() / 50; ++i)
+        list.remove(nextRandom(&state) % list.count());
+    for (int i = 0; i < list.count() / 50; ++i)
+        list.insert(nextRandom(&state) % list.count(), reference.count() + i);
+
+    return list;
+}
+
+void tst_SynchronizeLists::incremental_data()
+{
+    QTest::addColumn<int>("engine");
+    QTest::addColumn<int>("perturbation");
+
+    QTest::newRow("scanning swaps") << int(ScanningEngine) << int(Swaps);
+    QTest::newRow("scanning shuffle") << int(ScanningEngine) << int(Shuffle);
+    QTest::newRow("anchored swaps") << int(AnchoredEngine) << int(Swaps);
+    QTest::newRow("anchored moves") << int(AnchoredEngine) << int(Moves);
+    QTest::newRow("anchored reversal") << int(AnchoredEngine) << int(Reversal);
+    QTest::newRow("anchored shuffle") << int(AnchoredEngine) << int(Shuffle);
+}
+
+void tst_SynchronizeLists::incremental()
+{
+    QFETCH(int, engine);
+    QFETCH(int, perturbation);
+
+    List reference;
+    for (int i = 0; i < 1000; ++i)
+        reference.append(i);
+
+    m_filterEnabled = false;
+    m_cache = perturbedList(reference, static_cast<Perturbation>(perturbation));
+
+    // The reference list is received in batches, as from a query
+    List received;
+    int cacheIndex = 0;
+    int referenceIndex = 0;
+    for (int i = 0; i < reference.count(); i += 150) {
+        received += reference.mid(i, 150);
+        if (engine == AnchoredEngine) {
+            synchronizeList<AnchoredSynchronizeList>(this, m_cache, cacheIndex, received, referenceIndex);
+        } else {
+            synchronizeList(this, m_cache, cacheIndex, received, referenceIndex);
+        }
+    }
+    completeSynchronizeList(this, m_cache, cacheIndex, received, referenceIndex);
+
+    QCOMPARE(m_cache, reference);
+}
+
+void tst_SynchronizeLists::filteredIncremental()
+{
+    QFETCH(int, engine);
+    QFETCH(int, perturbation);
+
+    List reference;
+    List expected;
+    for (int i = 0; i < 1000; ++i) {
+        reference.append(i);
+        if (i % 3)
+            expected.append(i);
+    }
+
+    m_filterEnabled = true;
+    m_filter = expected;
+    m_filterCalls = 0;
+    m_cache = perturbedList(expected, static_cast<Perturbation>(perturbation));
+
+    // Each received value should be filtered once, however many times the list is synchronized
+    List received;
+    const FilteredReferenceList<tst_SynchronizeLists, List> filtered(this, received);
+    int cacheIndex = 0;
+    int referenceIndex = 0;
+    for (int i = 0; i < reference.count(); i += 150) {
+        received += reference.mid(i, 150);
+        if (engine == AnchoredEngine) {
+            synchronizeFilteredList<AnchoredSynchronizeList>(this, m_cache, cacheIndex, filtered, referenceIndex);
+        } else {
+            synchronizeFilteredList(this, m_cache, cacheIndex, filtered, referenceIndex);
+        }
+    }
+    completeSynchronizeList(this, m_cache, cacheIndex, filtered, referenceIndex);
+
+    QCOMPARE(m_cache, expected);
+    QCOMPARE(m_filterCalls, reference.count());
+}
+
+void tst_SynchronizeLists::perturbed_data()
+{
+    QTest::addColumn<int>("engine");
+    QTest::addColumn<int>("perturbation");
+
+    const char *names[] = { "swaps", "moves", "reversal", "shuffle" };
+    for (int perturbation = Swaps; perturbation <= Shuffle; ++perturbation) {
+        QTest::newRow((QByteArray("scanning ") + names[perturbation]).constData()) << int(ScanningEngine) << perturbation;
+        QTest::newRow((QByteArray("anchored ") + names[perturbation]).constData()) << int(AnchoredEngine) << perturbation;
+    }
+}
+
+void tst_SynchronizeLists::perturbed()
+{
+    QFETCH(int, engine);
+    QFETCH(int, perturbation);
+
+    List reference;
+    for (int i = 0; i < 10000; ++i)
+        reference.append(i);
+
+    const List original(perturbedList(reference, static_cast<Perturbation>(perturbation)));
+    m_filterEnabled = false;
+
+    QBENCHMARK {
+        m_cache = original;
+        if (engine == AnchoredEngine) {
+            synchronizeList<AnchoredSynchronizeList>(this, m_cache, reference);
+        } else {
+            synchronizeList(this, m_cache, reference);
+        }
+    }
+
+    QCOMPARE(m_cache, reference);
+}
+
+void tst_SynchronizeLists::moves_data()
+{
+    QTest::addColumn<List>("reference");
+    QTest::addColumn<List>("original");
+    QTest::addColumn<int>("moves");
+    QTest::addColumn<int>("moveRanges");
+
+    const List reference = List() << 0 << 1 << 2 << 3 << 4 << 5;
+
+    QTest::newRow("unchanged") << reference << reference << 0 << 0;
+    QTest::newRow("first to last") << reference << (List() << 5 << 0 << 1 << 2 << 3 << 4) << 1 << 1;
+    QTest::newRow("last to first") << reference << (List() << 1 << 2 << 3 << 4 << 5 << 0) << 1 << 1;
+    QTest::newRow("swap") << reference << (List() << 0 << 4 << 2 << 3 << 1 << 5) << 2 << 2;
+    QTest::newRow("renamed") << reference << (List() << 0 << 1 << 3 << 4 << 2 << 5) << 1 << 1;
+    QTest::newRow("moved and removed") << reference << (List() << 7 << 3 << 0 << 1 << 2 << 8 << 4 << 5) << 1 << 1;
+    QTest::newRow("moved and inserted") << reference << (List() << 0 << 4 << 1 << 5) << 1 << 1;
+    QTest::newRow("reversed") << reference << (List() << 5 << 4 << 3 << 2 << 1 << 0) << 5 << 5;
+    QTest::newRow("block moved") << reference << (List() << 3 << 4 << 5 << 0 << 1 << 2) << 3 << 1;
+    QTest::newRow("block moved back") << reference << (List() << 0 << 3 << 4 << 1 << 2 << 5) << 2 << 1;
+}
+
+void tst_SynchronizeLists::moves()
+{
+    QFETCH(List, reference);
+    QFETCH(List, original);
+    QFETCH(int, moves);
+    QFETCH(int, moveRanges);
+
+    MovingAgent agent(original);
+    synchronizeList<AnchoredSynchronizeList>(&agent, agent.cache, reference);
+
+    QCOMPARE(agent.cache, reference);
+    QCOMPARE(agent.moved, moves);
+
+    // Adjacent items moved to the same place are moved together
+    QCOMPARE(agent.moveRanges, moveRanges);
+
+    // Items present in both lists are never removed and reinserted
+    QSet<quint32> common(original.toList().toSet());
+    common.intersect(reference.toList().toSet());
+    QCOMPARE(agent.removed, original.count() - common.count());
+    QCOMPARE(agent.inserted, reference.count() - common.count());
+}
+
+void tst_SynchronizeLists::movesIncremental_data()
+{
+    QTest::addColumn<int>("perturbation");
+
+    QTest::newRow("swaps") << int(Swaps);
+    QTest::newRow("moves") << int(Moves);
+    QTest::newRow("reversal") << int(Reversal);
+    QTest::newRow("shuffle") << int(Shuffle);
+}
+
+void tst_SynchronizeLists::movesIncremental()
+{
+    QFETCH(int, perturbation);
+
+    List reference;
+    for (int i = 0; i < 1000; ++i)
+        reference.append(i);
+
+    MovingAgent agent(perturbedList(reference, static_cast<Perturbation>(perturbation)));
+
+    List received;
+    int cacheIndex = 0;
+    int referenceIndex = 0;
+    for (int i = 0; i < reference.count(); i += 150) {
+        received += reference.mid(i, 150);
+        synchronizeList<AnchoredSynchronizeList>(&agent, agent.cache, cacheIndex, received, referenceIndex);
+    }
+    completeSynchronizeList(&agent, agent.cache, cacheIndex, received, referenceIndex);
+
+    QCOMPARE(agent.cache, reference);
+}
+
 #include "tst_synchronizelists.moc"
 QTEST_APPLESS_MAIN(tst_SynchronizeLists)